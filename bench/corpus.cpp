@@ -0,0 +1,132 @@
+// Synthetic benchmark corpus: deterministic files covering the data classes
+// crush is tuned for, so `crush -b` numbers can be reproduced anywhere.
+//
+//   crush_corpus <out_dir> [bytes_per_file]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Rng = std::mt19937_64;
+
+// Uniformly random bytes: the incompressible worst case.
+static std::string makeRandom(size_t size, Rng& rng) {
+    std::string out(size, '\0');
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t v = rng();
+        std::memcpy(&out[i], &v, std::min<size_t>(8, size - i));
+    }
+    return out;
+}
+
+// Prose-like text: Zipf-distributed words from a fixed vocabulary.
+static std::string makeText(size_t size, Rng& rng) {
+    std::vector<std::string> vocab;
+    std::uniform_int_distribution<int> wordLen(2, 10), letter(0, 25);
+    for (int i = 0; i < 4096; ++i) {
+        std::string w;
+        for (int k = wordLen(rng); k > 0; --k) w += char('a' + letter(rng));
+        vocab.push_back(w);
+    }
+    std::vector<double> weights(vocab.size());
+    for (size_t i = 0; i < weights.size(); ++i) weights[i] = 1.0 / double(i + 1);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> punct(0, 15);
+
+    std::string out;
+    out.reserve(size + 16);
+    int words = 0;
+    while (out.size() < size) {
+        out += vocab[pick(rng)];
+        int p = punct(rng);
+        out += p == 0 ? ". " : p == 1 ? ", " : " ";
+        if (++words % 14 == 0) out += '\n';
+    }
+    out.resize(size);
+    return out;
+}
+
+// Log-like lines: a few templates with counters, very repetitive.
+static std::string makeRepetitive(size_t size, Rng& rng) {
+    static const char* kTemplates[] = {
+        "INFO  request served path=/api/v1/items status=200 latency_ms=%d\n",
+        "INFO  request served path=/api/v1/users status=200 latency_ms=%d\n",
+        "WARN  slow query table=orders rows=%d\n",
+        "DEBUG cache hit key=session:%d\n",
+        "ERROR upstream timeout host=10.0.0.%d retry=1\n",
+    };
+    std::uniform_int_distribution<int> which(0, 4), value(0, 250);
+    std::string out;
+    out.reserve(size + 128);
+    char line[160];
+    for (uint64_t ts = 1700000000000ull; out.size() < size; ts += 7) {
+        int n = std::snprintf(line, sizeof(line), "%llu ", static_cast<unsigned long long>(ts));
+        std::snprintf(line + n, sizeof(line) - n, kTemplates[which(rng)], value(rng));
+        out += line;
+    }
+    out.resize(size);
+    return out;
+}
+
+// Structured binary: fixed-size records with slowly changing fields.
+static std::string makeBinary(size_t size, Rng& rng) {
+    std::normal_distribution<float> step(0.0f, 0.5f);
+    std::uniform_int_distribution<int> type(0, 3);
+    std::string out;
+    out.reserve(size + 32);
+    uint32_t id = 0;
+    float value = 100.0f;
+    while (out.size() < size) {
+        uint8_t rec[24] = {0};
+        id += 1;
+        value += step(rng);
+        uint16_t t = uint16_t(type(rng));
+        uint64_t stamp = 1700000000ull * 1000 + id * 10ull;
+        std::memcpy(rec, &id, 4);
+        std::memcpy(rec + 4, &t, 2);
+        std::memcpy(rec + 8, &value, 4);
+        std::memcpy(rec + 16, &stamp, 8);
+        out.append(reinterpret_cast<const char*>(rec), sizeof(rec));
+    }
+    out.resize(size);
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc < 2) {
+            std::cerr << "usage: crush_corpus <out_dir> [bytes_per_file]\n";
+            return 1;
+        }
+        std::filesystem::path dir(argv[1]);
+        size_t size = argc > 2 ? size_t(std::stoull(argv[2])) : size_t(16) << 20;
+        std::filesystem::create_directories(dir);
+
+        struct Entry { const char* name; std::string (*make)(size_t, Rng&); };
+        const Entry entries[] = {
+            {"random.bin", makeRandom},
+            {"text.txt", makeText},
+            {"repetitive.log", makeRepetitive},
+            {"binary.dat", makeBinary},
+        };
+        for (const Entry& e : entries) {
+            Rng rng(0xC0FFEEu);
+            std::string data = e.make(size, rng);
+            std::ofstream out(dir / e.name, std::ios::binary);
+            out.write(data.data(), std::streamsize(data.size()));
+            if (!out) throw std::runtime_error(std::string("cannot write ") + e.name);
+            std::cout << "[corpus] " << (dir / e.name).string() << " (" << data.size() << " bytes)\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[corpus] error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
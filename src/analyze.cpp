@@ -0,0 +1,125 @@
+#include "analyze.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const size_t kWindows = 16;
+static const size_t kWindowSize = 4u << 10;
+static const unsigned kProbeHashLog = 12;
+static const unsigned kOrder2HashLog = 17;
+static const int kContextLevel = 8;
+// Prior weight of each unseen symbol in a context: a context seen only a few
+// times predicts little, so sparse samples are not mistaken for structure.
+static const double kContextPrior = 1.0 / 16;
+
+static uint32_t load32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+// Code length of bytes coded by adaptive context models, kept as a running
+// product of inverse probabilities so the log is taken once at the end.
+struct CodeLength {
+    double product = 1.0;
+    double bits = 0.0;
+
+    // Codes a symbol seen `seen` times in a context seen `total` times.
+    void add(uint16_t& seen, uint16_t& total) {
+        product *= (total + 256 * kContextPrior) / (seen + kContextPrior);
+        if (product > 0x1p500) { product *= 0x1p-500; bits += 500; }
+        ++seen;
+        ++total;
+    }
+    double value() const { return bits + std::log2(product); }
+};
+
+BlockProfile profileBlock(const uint8_t* src, size_t n, int level, Arena& arena) {
+    Arena::Scope scope(arena);
+    uint32_t counts[256] = {};
+    uint32_t* head = arena.allocZeroed<uint32_t>(size_t(1) << kProbeHashLog);  // hash -> pos + 1
+    size_t sampled = 0, covered = 0, matches = 0;
+
+    // Order-1 counts are exact; order-2 (context, symbol) pairs share a
+    // hash table, which the sample leaves mostly empty. The sample is at
+    // most 64 KiB, so every count fits 16 bits.
+    const bool contexts = level >= kContextLevel;
+    uint16_t *pairs1 = nullptr, *totals1 = nullptr, *pairs2 = nullptr, *totals2 = nullptr;
+    if (contexts) {
+        pairs1 = arena.allocZeroed<uint16_t>(size_t(1) << 16);
+        totals1 = arena.allocZeroed<uint16_t>(256);
+        pairs2 = arena.allocZeroed<uint16_t>(size_t(1) << kOrder2HashLog);
+        totals2 = arena.allocZeroed<uint16_t>(size_t(1) << 16);
+    }
+    CodeLength order1, order2;
+    size_t modeled = 0;
+
+    // Small blocks are read whole. The probe table is shared by all
+    // windows, so repeats between windows are found as well.
+    const size_t windows = n <= kWindows * kWindowSize ? 1 : kWindows;
+    const size_t width = windows == 1 ? n : kWindowSize;
+    for (size_t w = 0; w < windows; ++w) {
+        const size_t start = windows == 1 ? 0 : w * (n - width) / (windows - 1);
+        const size_t end = start + width;
+        for (size_t i = start; i < end; ++i) ++counts[src[i]];
+        sampled += width;
+        // Both orders code the same bytes, those with two bytes of context
+        for (size_t i = start + 2; contexts && i < end; ++i) {
+            const uint32_t ctx = uint32_t(src[i - 2]) << 8 | src[i - 1];
+            const uint32_t key = ctx << 8 | src[i];
+            order1.add(pairs1[key & 0xFFFF], totals1[src[i - 1]]);
+            order2.add(pairs2[(key * 2654435761u) >> (32 - kOrder2HashLog)], totals2[ctx]);
+            ++modeled;
+        }
+
+        size_t pos = start;
+        while (pos + 4 <= end) {
+            uint32_t& slot = head[(load32(src + pos) * 2654435761u) >> (32 - kProbeHashLog)];
+            const size_t cand = slot;
+            slot = uint32_t(pos + 1);
+            if (cand == 0 || load32(src + cand - 1) != load32(src + pos)) {
+                ++pos;
+                continue;
+            }
+            size_t len = 4;
+            while (pos + len < end && src[cand - 1 + len] == src[pos + len]) ++len;
+            covered += len;
+            ++matches;
+            pos += len;
+        }
+    }
+
+    BlockProfile profile{0.0, 0.0, 0.0, 0.0, 0.0};
+    if (sampled == 0) return profile;
+    for (uint32_t c : counts) {
+        if (c == 0) continue;
+        double p = double(c) / double(sampled);
+        profile.entropy -= p * std::log2(p);
+    }
+    profile.matchCover = double(covered) / double(sampled);
+    profile.matchDensity = double(matches) / double(sampled);
+    if (modeled) {
+        profile.order1Cost = order1.value() / 8.0 / double(modeled);
+        profile.order2Cost = order2.value() / 8.0 / double(modeled);
+    }
+    return profile;
+}
+
+Algorithm pickAlgorithm(const BlockProfile& profile, int level) {
+    // Estimated output bytes per input byte. From level 4 LZ77 Huffman
+    // codes its literals and tokens, so unmatched bytes cost about the
+    // order-0 entropy and a match a couple of bytes.
+    const double entropyCost = profile.entropy / 8.0;
+    const double literalCost = level >= 4 ? std::min(1.0, entropyCost + 0.02) : 1.0;
+    const double matchCost = level >= 4 ? 2.5 : 3.5;
+    const double lzCost = (1.0 - profile.matchCover) * literalCost + profile.matchDensity * matchCost;
+
+    if (std::min(lzCost, entropyCost) > 0.97) return Algorithm::Stored;
+    if (lzCost < entropyCost * 0.9) {
+        // The BWT codes each byte by its sorted context, so it pulls ahead
+        // where a second byte of context predicts clearly better than one,
+        // as in text, unless long repeats make LZ77 far cheaper still. It
+        // is much slower, so only the top levels spend that.
+        if (level >= kContextLevel && profile.order2Cost < profile.order1Cost * 0.95 &&
+            profile.order2Cost < lzCost * 1.75)
+            return Algorithm::BWT;
+        return Algorithm::LZ77;
+    }
+    return level >= 6 ? Algorithm::Arithmetic : Algorithm::Huffman;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "arena.hpp"
+#include "compressor.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// ===== Block analysis for -a auto =====
+// A cheap look at a sample of the block (up to 64 KiB in 16 evenly spaced
+// windows) instead of trial-compressing it with every codec.
+struct BlockProfile {
+    double entropy;       // order-0 entropy of the sample, bits per byte
+    double matchCover;    // fraction of sampled bytes covered by 4+ byte matches
+    double matchDensity;  // matches found per sampled byte
+    double order1Cost;    // adaptive order-1 / order-2 coding cost of the sample,
+    double order2Cost;    // output bytes per byte (level 8 and up only, else 0)
+};
+
+// The context costs are only worth their tables where auto may pick the
+// BWT, so they are skipped below level 8.
+BlockProfile profileBlock(const uint8_t* src, size_t n, int level, Arena& arena);
+
+// Codec for one block of an auto archive: the fastest one whose estimated
+// output beats the others by a useful margin, or Algorithm::Stored when
+// nothing is expected to save space.
+Algorithm pickAlgorithm(const BlockProfile& profile, int level);
@@ -0,0 +1,37 @@
+#include "arena.hpp"
+#include <algorithm>
+
+void* Arena::allocBytes(size_t bytes) {
+    bytes = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+    if (!chunks.empty() && chunks[current].size - used >= bytes) {
+        void* p = chunks[current].data.get() + used;
+        used += bytes;
+        return p;
+    }
+    // Move on to the next chunk that fits, or add one
+    size_t next = chunks.empty() ? 0 : current + 1;
+    while (next < chunks.size() && chunks[next].size < bytes) ++next;
+    if (next == chunks.size()) {
+        size_t size = std::max({bytes, kMinChunk, chunks.empty() ? size_t(0) : chunks.back().size * 2});
+        chunks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[size]), size});
+    }
+    current = next;
+    used = bytes;
+    return chunks[current].data.get();
+}
+
+void Arena::reset() {
+    if (chunks.size() > 1) {
+        size_t total = capacity();
+        chunks.clear();
+        chunks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[total]), total});
+    }
+    current = 0;
+    used = 0;
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (const Chunk& c : chunks) total += c.size;
+    return total;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// ===== Scratch arena =====
+// Bump allocator for per-block scratch memory. Allocations are released
+// all at once, by reset() or when a Scope ends; nothing is freed on its
+// own. A call that outgrows the current chunk adds overflow chunks, and
+// the next reset() merges them into one chunk of the combined size, so an
+// arena that is reused for similar work settles at zero heap allocations.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    // Uninitialised storage for `count` objects of trivial type T.
+    template <typename T>
+    T* alloc(size_t count) {
+        static_assert(alignof(T) <= kAlignment, "over-aligned arena type");
+        return static_cast<T*>(allocBytes(count * sizeof(T)));
+    }
+
+    template <typename T>
+    T* allocZeroed(size_t count) {
+        T* p = alloc<T>(count);
+        std::memset(static_cast<void*>(p), 0, count * sizeof(T));
+        return p;
+    }
+
+    // Releases everything and merges overflow chunks.
+    void reset();
+
+    // Bytes currently reserved from the heap.
+    size_t capacity() const;
+
+    // Releases everything allocated while the scope was alive.
+    class Scope {
+    public:
+        explicit Scope(Arena& arena) : arena(arena), chunk(arena.current), used(arena.used) {}
+        ~Scope() { arena.current = chunk; arena.used = used; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Arena& arena;
+        size_t chunk;
+        size_t used;
+    };
+
+private:
+    static constexpr size_t kAlignment = 16;
+    static constexpr size_t kMinChunk = 64u << 10;
+
+    struct Chunk {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+    std::vector<Chunk> chunks;
+    size_t current = 0;  // chunk being carved
+    size_t used = 0;     // bytes handed out from chunks[current]
+
+    void* allocBytes(size_t bytes);
+};
@@ -0,0 +1,169 @@
+#include "compressor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ===== Peak memory =====
+// Linux exposes the resettable RSS high-water mark; elsewhere the column
+// reports 0.
+static void resetPeakRss() {
+#ifdef __linux__
+    std::ofstream f("/proc/self/clear_refs");
+    if (f) f << "5";
+#endif
+}
+
+static size_t peakRssBytes() {
+#ifdef __linux__
+    std::ifstream f("/proc/self/status");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return size_t(std::stoull(line.substr(6))) * 1024;
+    }
+#endif
+    return 0;
+}
+
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+struct BenchResult {
+    Algorithm algo;
+    int level;
+    int threads;
+    size_t blockSize;
+    size_t inputBytes;
+    size_t outputBytes;
+    double compMedian, compBest;     // MB/s from the median and minimum times
+    double decompMedian, decompBest;
+    size_t peakRss;
+    bool roundTripOk;
+};
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t m = v.size() / 2;
+    return v.size() % 2 ? v[m] : (v[m - 1] + v[m]) / 2;
+}
+
+static void printRow(const std::string& input, const BenchResult& r, const std::string& format, bool first) {
+    double ratio = r.outputBytes ? double(r.inputBytes) / double(r.outputBytes) : 0.0;
+    std::ostream& out = std::cout;
+    if (format == "csv") {
+        out << input << ',' << algorithmName(r.algo) << ',' << r.level << ',' << r.threads << ',' << r.blockSize << ','
+            << r.inputBytes << ',' << r.outputBytes << ',' << std::fixed << std::setprecision(4) << ratio << ','
+            << std::setprecision(2) << r.compMedian << ',' << r.compBest << ','
+            << r.decompMedian << ',' << r.decompBest << ',' << r.peakRss << ','
+            << (r.roundTripOk ? "ok" : "FAIL") << "\n";
+    } else if (format == "json") {
+        out << (first ? "  " : ", ") << "{\"input\": \"" << jsonEscape(input) << "\", \"algo\": \"" << algorithmName(r.algo) << "\", \"level\": " << r.level
+            << ", \"threads\": " << r.threads << ", \"block_size\": " << r.blockSize
+            << ", \"input_bytes\": " << r.inputBytes << ", \"output_bytes\": " << r.outputBytes
+            << std::fixed << std::setprecision(4) << ", \"ratio\": " << ratio << std::setprecision(2)
+            << ", \"compress_mbps_median\": " << r.compMedian << ", \"compress_mbps_best\": " << r.compBest
+            << ", \"decompress_mbps_median\": " << r.decompMedian
+            << ", \"decompress_mbps_best\": " << r.decompBest
+            << ", \"peak_rss_bytes\": " << r.peakRss
+            << ", \"round_trip\": " << (r.roundTripOk ? "true" : "false") << "}\n";
+    } else {
+        out << std::left << std::setw(7) << algorithmName(r.algo) << std::right
+            << std::setw(6) << r.level << std::setw(8) << r.threads
+            << std::fixed << std::setprecision(3) << std::setw(8) << ratio
+            << std::setprecision(1) << std::setw(11) << r.compMedian << std::setw(11) << r.compBest
+            << std::setw(11) << r.decompMedian << std::setw(11) << r.decompBest
+            << std::setw(10) << double(r.peakRss) / (1 << 20)
+            << "  " << (r.roundTripOk ? "ok" : "FAIL") << "\n";
+    }
+}
+
+static void printHeader(const std::string& format) {
+    if (format == "csv") {
+        std::cout << "input,algo,level,threads,block_size,input_bytes,output_bytes,ratio,"
+                     "compress_mbps_median,compress_mbps_best,decompress_mbps_median,"
+                     "decompress_mbps_best,peak_rss_bytes,round_trip\n";
+    } else if (format == "json") {
+        std::cout << "[\n";
+    } else {
+        std::cout << std::left << std::setw(7) << "algo" << std::right << std::setw(6) << "level"
+                  << std::setw(8) << "threads" << std::setw(8) << "ratio"
+                  << std::setw(11) << "C med MB/s" << std::setw(11) << "C best"
+                  << std::setw(11) << "D med MB/s" << std::setw(11) << "D best"
+                  << std::setw(10) << "peak MB" << "  check\n";
+    }
+}
+
+void Compressor::benchmark(const std::string &input, const BenchmarkOptions &options) {
+    if (options.format != "table" && options.format != "csv" && options.format != "json")
+        throw std::runtime_error("Unknown benchmark format: " + options.format);
+    std::ifstream fin(input, std::ios::binary);
+    if (!fin) throw std::runtime_error("Cannot open input file");
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+    std::vector<Algorithm> algos = options.algos;
+    if (algos.empty())
+        algos = {Algorithm::Huffman, Algorithm::LZ77, Algorithm::BWT, Algorithm::Arithmetic, Algorithm::Auto};
+    const double mb = double(data.size()) / (1 << 20);
+    const int iterations = std::max(1, options.iterations);
+    using Clock = std::chrono::steady_clock;
+
+    printHeader(options.format);
+    bool first = true, allOk = true;
+    std::vector<uint8_t> archive, restored;
+    for (Algorithm algo : algos) {
+        for (int level : options.levels) {
+            for (int threads : options.threads) {
+                archive = std::vector<uint8_t>();
+                restored = std::vector<uint8_t>();
+                resetPeakRss();
+                for (int i = 0; i < options.warmup; ++i) {
+                    compressBuffer(data.data(), data.size(), archive, algo, level, threads, options.blockSize);
+                    decompressBuffer(archive.data(), archive.size(), restored, threads);
+                }
+                std::vector<double> compTimes, decompTimes;
+                for (int i = 0; i < iterations; ++i) {
+                    auto t0 = Clock::now();
+                    compressBuffer(data.data(), data.size(), archive, algo, level, threads, options.blockSize);
+                    auto t1 = Clock::now();
+                    decompressBuffer(archive.data(), archive.size(), restored, threads);
+                    auto t2 = Clock::now();
+                    compTimes.push_back(std::chrono::duration<double>(t1 - t0).count());
+                    decompTimes.push_back(std::chrono::duration<double>(t2 - t1).count());
+                }
+                auto rate = [&](double seconds) { return seconds > 0 ? mb / seconds : 0.0; };
+
+                BenchResult r;
+                r.algo = algo;
+                r.level = level;
+                r.threads = threads;
+                r.blockSize = options.blockSize ? options.blockSize : defaultBlockSize(level);
+                r.inputBytes = data.size();
+                r.outputBytes = archive.size();
+                r.compMedian = rate(median(compTimes));
+                r.compBest = rate(*std::min_element(compTimes.begin(), compTimes.end()));
+                r.decompMedian = rate(median(decompTimes));
+                r.decompBest = rate(*std::min_element(decompTimes.begin(), decompTimes.end()));
+                r.peakRss = peakRssBytes();
+                r.roundTripOk = restored == data;
+                allOk &= r.roundTripOk;
+                printRow(input, r, options.format, first);
+                first = false;
+            }
+        }
+    }
+    if (options.format == "json") std::cout << "]\n";
+    std::cout.flush();
+    if (!allOk) throw std::runtime_error("benchmark round-trip check failed");
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+// ===== Little-endian fields =====
+// Headers and integers in every format are little-endian, written byte by
+// byte so the layout does not depend on the host.
+
+inline uint16_t getU16(const uint8_t* p) { return uint16_t(p[0] | p[1] << 8); }
+
+inline uint32_t getU32(const uint8_t* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+inline uint64_t getU64(const uint8_t* p) { return uint64_t(getU32(p)) | uint64_t(getU32(p + 4)) << 32; }
+
+inline void storeU16(uint8_t* p, uint32_t v) { p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); }
+
+inline void storeU32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); p[2] = uint8_t(v >> 16); p[3] = uint8_t(v >> 24);
+}
+
+inline void putU16(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(uint8_t(v));
+    out.push_back(uint8_t(v >> 8));
+}
+
+inline void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    uint8_t b[4];
+    storeU32(b, v);
+    out.insert(out.end(), b, b + 4);
+}
+
+inline void putU64(std::vector<uint8_t>& out, uint64_t v) {
+    putU32(out, uint32_t(v));
+    putU32(out, uint32_t(v >> 32));
+}
+
+// ===== Bit-level I/O =====
+// Bits are packed MSB-first: the first bit of the stream is the top bit of
+// the first byte.
+
+inline uint64_t loadBE64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+#if defined(_MSC_VER)
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+inline void storeBE64(uint8_t* p, uint64_t v) {
+#if defined(_MSC_VER)
+    v = _byteswap_uint64(v);
+#else
+    v = __builtin_bswap64(v);
+#endif
+    std::memcpy(p, &v, 8);
+}
+
+// Accumulates codes in a 64-bit register and flushes whole bytes with a
+// single 8-byte store. The caller reserves room: write() may touch up to
+// 8 bytes past the current position.
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : out(out), begin(out) {}
+
+    // n <= 32 bits; at most 56 bits may be pending between flush() calls
+    void write(uint32_t value, unsigned n) {
+        count += n;
+        bits |= uint64_t(value) << (64 - count);
+    }
+
+    void flush() {
+        storeBE64(out, bits);
+        out += count >> 3;
+        bits <<= count & ~7u;
+        count &= 7;
+    }
+
+    // Pads the last partial byte with zeros; returns bytes written.
+    size_t finish() {
+        flush();
+        if (count) { *out++ = uint8_t(bits >> 56); bits = 0; count = 0; }
+        return size_t(out - begin);
+    }
+
+private:
+    uint8_t* out;
+    uint8_t* begin;
+    uint64_t bits = 0;
+    unsigned count = 0;
+};
+
+// Keeps 56..63 bits buffered in a left-aligned 64-bit register so callers
+// can peek/consume up to 56 bits per refill without touching memory.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    void refill() {
+        if (pos + 8 <= size) {
+            bits |= loadBE64(data + pos) >> count;
+            pos += (63 - count) >> 3;
+            count |= 56;
+        } else {
+            // Past the end the stream reads as zeros; overrun() reports it
+            while (count <= 56) {
+                uint64_t b = pos < size ? data[pos] : 0;
+                bits |= b << (56 - count);
+                ++pos;
+                count += 8;
+            }
+        }
+    }
+
+    uint32_t peek(unsigned n) const { return uint32_t(bits >> (64 - n)); }
+    void consume(unsigned n) { bits <<= n; count -= n; }
+    unsigned available() const { return count; }
+
+    // True once more bits were consumed than the input held
+    bool overrun() const {
+        return pos * 8 - count > size * 8;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    uint64_t bits = 0;
+    unsigned count = 0;
+};
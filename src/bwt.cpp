@@ -0,0 +1,391 @@
+#include "bwt.hpp"
+#include "bitio.hpp"
+#include "huffman.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// ===== Suffix array (SA-IS) =====
+template <typename T>
+static void saNaive(const T* s, int n, int32_t* sa) {
+    for (int i = 0; i < n; ++i) sa[i] = i;
+    std::sort(sa, sa + n, [&](int32_t a, int32_t b) {
+        return std::lexicographical_compare(s + a, s + n, s + b, s + n);
+    });
+}
+
+// Induced sorting over an alphabet [0, upper]. Recurses on the reduced
+// string of LMS substrings until names are unique. Scratch comes from the
+// arena and is released level by level.
+template <typename T>
+static void saIs(const T* s, int n, int upper, int32_t* sa, Arena& arena) {
+    if (n < 16) { saNaive(s, n, sa); return; }
+    Arena::Scope scope(arena);
+
+    // ls[i]: suffix i is S-type (smaller than suffix i + 1)
+    uint8_t* ls = arena.alloc<uint8_t>(n);
+    ls[n - 1] = 0;
+    for (int i = n - 2; i >= 0; --i)
+        ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+
+    // Bucket starts: sumL[c] for L-type, sumS[c] for S-type
+    int32_t* sumL = arena.allocZeroed<int32_t>(upper + 2);
+    int32_t* sumS = arena.allocZeroed<int32_t>(upper + 2);
+    for (int i = 0; i < n; ++i) {
+        if (!ls[i]) sumS[s[i]]++;
+        else sumL[s[i] + 1]++;
+    }
+    for (int c = 0; c <= upper; ++c) {
+        sumS[c] += sumL[c];
+        if (c < upper) sumL[c + 1] += sumS[c];
+    }
+
+    int32_t* buf = arena.alloc<int32_t>(upper + 2);
+    auto induce = [&](const int32_t* lms, int count) {
+        std::fill(sa, sa + n, -1);
+        std::copy(sumS, sumS + upper + 2, buf);
+        for (int i = 0; i < count; ++i) sa[buf[s[lms[i]]]++] = lms[i];
+        std::copy(sumL, sumL + upper + 2, buf);
+        sa[buf[s[n - 1]]++] = n - 1;
+        for (int i = 0; i < n; ++i) {
+            int32_t v = sa[i];
+            if (v >= 1 && !ls[v - 1]) sa[buf[s[v - 1]]++] = v - 1;
+        }
+        std::copy(sumL, sumL + upper + 2, buf);
+        for (int i = n - 1; i >= 0; --i) {
+            int32_t v = sa[i];
+            if (v >= 1 && ls[v - 1]) sa[--buf[s[v - 1] + 1]] = v - 1;
+        }
+    };
+
+    int32_t* lmsMap = arena.alloc<int32_t>(n + 1);
+    std::fill(lmsMap, lmsMap + n + 1, -1);
+    int m = 0;
+    for (int i = 1; i < n; ++i)
+        if (!ls[i - 1] && ls[i]) lmsMap[i] = m++;
+    int32_t* lms = arena.alloc<int32_t>(m);
+    for (int i = 1; i < n; ++i)
+        if (!ls[i - 1] && ls[i]) lms[lmsMap[i]] = i;
+    induce(lms, m);
+    if (m == 0) return;
+
+    int32_t* sortedLms = arena.alloc<int32_t>(m);
+    for (int i = 0, k = 0; i < n; ++i)
+        if (lmsMap[sa[i]] != -1) sortedLms[k++] = sa[i];
+
+    // Name LMS substrings; equal substrings share a name
+    int32_t* recS = arena.alloc<int32_t>(m);
+    int recUpper = 0;
+    recS[lmsMap[sortedLms[0]]] = 0;
+    for (int i = 1; i < m; ++i) {
+        int l = sortedLms[i - 1], r = sortedLms[i];
+        int endL = (lmsMap[l] + 1 < m) ? lms[lmsMap[l] + 1] : n;
+        int endR = (lmsMap[r] + 1 < m) ? lms[lmsMap[r] + 1] : n;
+        bool same = true;
+        if (endL - l != endR - r) {
+            same = false;
+        } else {
+            while (l < endL && s[l] == s[r]) { ++l; ++r; }
+            if (l == n || s[l] != s[r]) same = false;
+        }
+        if (!same) ++recUpper;
+        recS[lmsMap[sortedLms[i]]] = recUpper;
+    }
+
+    int32_t* recSa = arena.alloc<int32_t>(m);
+    saIs(recS, m, recUpper, recSa, arena);
+    for (int i = 0; i < m; ++i) sortedLms[i] = lms[recSa[i]];
+    induce(sortedLms, m);
+}
+
+void suffixArray(const uint8_t* s, size_t n, int32_t* sa, Arena& arena) {
+    if (n > size_t(INT32_MAX) - 1) throw std::runtime_error("BWT block too large");
+    if (n) saIs(s, int(n), 255, sa, arena);
+}
+
+// ===== Transform =====
+uint32_t bwtForward(const uint8_t* src, size_t n, uint8_t* out, Arena& arena) {
+    if (n == 0) return 0;
+    Arena::Scope scope(arena);
+    int32_t* sa = arena.alloc<int32_t>(n);
+    suffixArray(src, n, sa, arena);
+    // Row 0 is the sentinel suffix, preceded by the last byte
+    uint32_t primary = 0;
+    *out++ = src[n - 1];
+    for (size_t r = 0; r < n; ++r) {
+        if (sa[r] == 0) primary = uint32_t(r + 1);
+        else *out++ = src[sa[r] - 1];
+    }
+    return primary;
+}
+
+bool bwtInverse(const uint8_t* bwt, size_t n, uint32_t primary, uint8_t* dst, Arena& arena) {
+    if (n == 0) return primary == 0;
+    if (primary == 0 || primary > n) return false;
+
+    // Rows are 0..n with the sentinel at `primary`; C counts it as smallest
+    uint32_t start[256] = {0};
+    for (size_t i = 0; i < n; ++i) start[bwt[i]]++;
+    uint32_t sum = 1;
+    for (int c = 0; c < 256; ++c) { uint32_t t = start[c]; start[c] = sum; sum += t; }
+
+    // The walk below is one dependent random access per byte; when row
+    // numbers fit in 24 bits the byte rides along in the same word so each
+    // step touches a single cache line.
+    Arena::Scope scope(arena);
+    uint32_t* lf = arena.alloc<uint32_t>(n + 1);
+    // The sentinel row is never stepped from in a valid block; a walk that
+    // reaches it early means `primary` is corrupt.
+    lf[primary] = 0;
+    size_t row = 0;
+    if (n < (1u << 24)) {
+        for (size_t r = 0; r <= n; ++r) {
+            if (r == primary) continue;
+            uint8_t c = bwt[r < primary ? r : r - 1];
+            lf[r] = start[c]++ << 8 | c;
+        }
+        for (size_t k = n; k-- > 0;) {
+            if (row == primary) return false;
+            uint32_t e = lf[row];
+            dst[k] = uint8_t(e);
+            row = e >> 8;
+        }
+    } else {
+        for (size_t r = 0; r <= n; ++r) {
+            if (r == primary) continue;
+            lf[r] = start[bwt[r < primary ? r : r - 1]]++;
+        }
+        for (size_t k = n; k-- > 0;) {
+            if (row == primary) return false;
+            dst[k] = bwt[row < primary ? row : row - 1];
+            row = lf[row];
+        }
+    }
+    return row == primary;
+}
+
+// ===== Back end: MTF + zero-run RLE + multi-table Huffman =====
+// After the transform, MTF turns local repetition into small ranks; runs of
+// rank 0 are written as bijective base-2 numbers with the RUNA/RUNB digits
+// and rank r >= 1 becomes symbol r + 1. The symbol stream is split into
+// groups of 50 and each group picks the best of up to six Huffman tables.
+static const int kRunA = 0;
+static const int kRunB = 1;
+static const int kBwtSymbols = 257;
+static const int kGroupSize = 50;
+static const int kMaxTables = 6;
+static const int kSelectorBits = 3;
+static const size_t kTableBytes = (kBwtSymbols + 1) / 2;
+
+static uint16_t* emitRun(uint32_t run, uint16_t* out) {
+    while (run > 0) {
+        --run;
+        *out++ = uint16_t((run & 1) ? kRunB : kRunA);
+        run >>= 1;
+    }
+    return out;
+}
+
+// Writes at most n symbols to out and returns the count.
+static size_t mtfRleEncode(const uint8_t* bwt, size_t n, uint16_t* out) {
+    uint16_t* const start = out;
+    uint8_t list[256];
+    for (int i = 0; i < 256; ++i) list[i] = uint8_t(i);
+    uint32_t zeros = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t c = bwt[i];
+        if (list[0] == c) { ++zeros; continue; }
+        out = emitRun(zeros, out);
+        zeros = 0;
+        // Rank 1 is the common case after BWT; deeper ranks use the
+        // library's vectorised search and move, as the decoder does
+        size_t j = 1;
+        if (list[1] == c) list[1] = list[0];
+        else {
+            j = size_t(static_cast<const uint8_t*>(std::memchr(list + 2, c, 254)) - list);
+            std::memmove(list + 1, list, j);
+        }
+        list[0] = c;
+        *out++ = uint16_t(j + 1);
+    }
+    out = emitRun(zeros, out);
+    return size_t(out - start);
+}
+
+static int tableCount(size_t symbols) {
+    if (symbols < 200) return 2;
+    if (symbols < 600) return 3;
+    if (symbols < 1200) return 4;
+    if (symbols < 2400) return 5;
+    return kMaxTables;
+}
+
+void bwtEncode(const uint8_t* src, size_t n, std::vector<uint8_t>& out, Arena& arena) {
+    if (n == 0) return;
+    if (n > UINT32_MAX) throw std::runtime_error("BWT block too large");
+    Arena::Scope scope(arena);
+    uint8_t* transformed = arena.alloc<uint8_t>(n);
+    uint32_t primary = bwtForward(src, n, transformed, arena);
+
+    // A zero run of length r takes at most log2(r + 1) digits, so there is
+    // never more than one symbol per input byte
+    uint16_t* syms = arena.alloc<uint16_t>(n);
+    const size_t count = mtfRleEncode(transformed, n, syms);
+    const size_t groups = (count + kGroupSize - 1) / kGroupSize;
+    const int numTables = tableCount(count);
+
+    // Seed each table with a slice of the alphabet holding ~1/T of the
+    // symbols, then refine: assign every group to its cheapest table and
+    // rebuild the tables from what they were assigned.
+    uint32_t freq[kBwtSymbols] = {0};
+    for (size_t i = 0; i < count; ++i) freq[syms[i]]++;
+    uint8_t cost[kMaxTables][kBwtSymbols];
+    {
+        size_t remaining = count;
+        int lo = 0;
+        for (int t = 0; t < numTables; ++t) {
+            size_t target = remaining / (numTables - t), acc = 0;
+            int hi = lo - 1;
+            while (acc < target && hi < kBwtSymbols - 1) acc += freq[++hi];
+            for (int v = 0; v < kBwtSymbols; ++v) cost[t][v] = (v >= lo && v <= hi) ? 0 : 15;
+            lo = hi + 1;
+            remaining -= acc;
+        }
+    }
+
+    uint8_t lens[kMaxTables][kBwtSymbols];
+    uint8_t* selectors = arena.alloc<uint8_t>(groups);
+    for (int iter = 0; iter < 4; ++iter) {
+        uint32_t tableFreq[kMaxTables][kBwtSymbols] = {{0}};
+        for (size_t g = 0; g < groups; ++g) {
+            size_t begin = g * kGroupSize, end = std::min(count, begin + kGroupSize);
+            uint32_t best = UINT32_MAX;
+            int bestTable = 0;
+            for (int t = 0; t < numTables; ++t) {
+                uint32_t c = 0;
+                for (size_t i = begin; i < end; ++i) c += cost[t][syms[i]];
+                if (c < best) { best = c; bestTable = t; }
+            }
+            selectors[g] = uint8_t(bestTable);
+            for (size_t i = begin; i < end; ++i) tableFreq[bestTable][syms[i]]++;
+        }
+        for (int t = 0; t < numTables; ++t) {
+            huffmanCodeLengths(tableFreq[t], kBwtSymbols, lens[t]);
+            // A table that never saw a symbol must not look free for it
+            for (int v = 0; v < kBwtSymbols; ++v) cost[t][v] = lens[t][v] ? lens[t][v] : 16;
+        }
+    }
+
+    // primary u32 LE | symbol count u32 LE | table count u8 | T x 257 nibbles |
+    // bitstream: 3-bit selectors, then the symbols
+    size_t start = out.size();
+    size_t headerSize = 4 + 4 + 1 + numTables * kTableBytes;
+    out.resize(start + headerSize + (groups * kSelectorBits + count * kHuffmanMaxCodeLength) / 8 + 16);
+    uint8_t* p = out.data() + start;
+    storeU32(p, primary);
+    storeU32(p + 4, uint32_t(count));
+    p[8] = uint8_t(numTables);
+    p += 9;
+    uint32_t codes[kMaxTables][kBwtSymbols];
+    for (int t = 0; t < numTables; ++t) {
+        huffmanCanonicalCodes(lens[t], kBwtSymbols, codes[t]);
+        for (int v = 0; v < kBwtSymbols; v += 2)
+            *p++ = uint8_t(lens[t][v] << 4 | (v + 1 < kBwtSymbols ? lens[t][v + 1] : 0));
+    }
+
+    BitWriter bw(p);
+    for (size_t g = 0; g < groups; ++g) {
+        bw.write(selectors[g], kSelectorBits);
+        bw.flush();
+    }
+    for (size_t g = 0; g < groups; ++g) {
+        const uint8_t* len = lens[selectors[g]];
+        const uint32_t* code = codes[selectors[g]];
+        size_t begin = g * kGroupSize, end = std::min(count, begin + kGroupSize);
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4) {
+            for (size_t k = i; k < i + 4; ++k) bw.write(code[syms[k]], len[syms[k]]);
+            bw.flush();
+        }
+        for (; i < end; ++i) {
+            bw.write(code[syms[i]], len[syms[i]]);
+            bw.flush();
+        }
+    }
+    out.resize(start + headerSize + bw.finish());
+}
+
+void bwtDecode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Arena& arena) {
+    if (rawSize == 0) {
+        if (n != 0) throw std::runtime_error("Corrupt BWT block");
+        return;
+    }
+    if (n < 9) throw std::runtime_error("Corrupt BWT block");
+    const uint32_t primary = getU32(src), count = getU32(src + 4);
+    int numTables = src[8];
+    size_t headerSize = 9 + numTables * kTableBytes;
+    if (numTables < 1 || numTables > kMaxTables || n < headerSize || count > rawSize)
+        throw std::runtime_error("Corrupt BWT block");
+
+    Arena::Scope scope(arena);
+    HuffmanDecodeTable* tables = arena.alloc<HuffmanDecodeTable>(numTables);
+    for (int t = 0; t < numTables; ++t) {
+        uint8_t lens[kBwtSymbols + 1];
+        const uint8_t* p = src + 9 + t * kTableBytes;
+        for (size_t i = 0; i < kTableBytes; ++i) { lens[2 * i] = p[i] >> 4; lens[2 * i + 1] = p[i] & 15; }
+        if (!tables[t].build(lens, kBwtSymbols)) throw std::runtime_error("Corrupt BWT block");
+    }
+
+    BitReader br(src + headerSize, n - headerSize);
+    const size_t groups = (size_t(count) + kGroupSize - 1) / kGroupSize;
+    uint8_t* selectors = arena.alloc<uint8_t>(groups);
+    for (size_t g = 0; g < groups; ++g) {
+        if (br.available() < kSelectorBits) br.refill();
+        selectors[g] = uint8_t(br.peek(kSelectorBits));
+        br.consume(kSelectorBits);
+        if (selectors[g] >= numTables) throw std::runtime_error("Corrupt BWT block");
+    }
+
+    // Huffman decode, undo the zero runs and MTF in one pass
+    uint8_t* out = arena.alloc<uint8_t>(rawSize);
+    size_t written = 0;
+    uint8_t list[256];
+    for (int i = 0; i < 256; ++i) list[i] = uint8_t(i);
+    size_t run = 0, runWeight = 1;
+    bool bad = false;
+    for (size_t g = 0; g < groups && !bad; ++g) {
+        const uint16_t* entries = tables[selectors[g]].entries;
+        size_t end = std::min<size_t>(count, (g + 1) * kGroupSize);
+        for (size_t i = g * kGroupSize; i < end; ++i) {
+            if (br.available() < kHuffmanMaxCodeLength) br.refill();
+            uint16_t e = entries[br.peek(kHuffmanMaxCodeLength)];
+            if ((e & 15) == 0) { bad = true; break; }
+            br.consume(e & 15);
+            int v = e >> 4;
+            if (v <= kRunB) {
+                run += size_t(v + 1) * runWeight;
+                runWeight <<= 1;
+                if (run > rawSize - written) { bad = true; break; }
+                continue;
+            }
+            if (run) {
+                std::memset(out + written, list[0], run);
+                written += run;
+                run = 0;
+            }
+            runWeight = 1;
+            if (written == rawSize) { bad = true; break; }
+            int rank = v - 1;
+            uint8_t c = list[rank];
+            std::memmove(list + 1, list, rank);
+            list[0] = c;
+            out[written++] = c;
+        }
+    }
+    if (!bad && run) {
+        std::memset(out + written, list[0], run);
+        written += run;
+    }
+    if (bad || written != rawSize || br.overrun()) throw std::runtime_error("Corrupt BWT block");
+    if (!bwtInverse(out, rawSize, primary, dst, arena)) throw std::runtime_error("Corrupt BWT block");
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===== Burrows-Wheeler transform =====
+// Suffix array of s (SA-IS, linear time). Shorter suffixes sort first, as if
+// s were terminated by a unique smallest sentinel. sa holds n entries.
+void suffixArray(const uint8_t* s, size_t n, int32_t* sa, Arena& arena);
+
+// Writes the n-byte BWT of src to out and returns the primary index: the
+// row of the implicit sentinel, which is left out of the output.
+uint32_t bwtForward(const uint8_t* src, size_t n, uint8_t* out, Arena& arena);
+
+// LF-mapping inverse of bwtForward. Returns false on an invalid primary index.
+bool bwtInverse(const uint8_t* bwt, size_t n, uint32_t primary, uint8_t* dst, Arena& arena);
+
+// BWT followed by MTF, zero-run coding and multi-table Huffman.
+void bwtEncode(const uint8_t* src, size_t n, std::vector<uint8_t>& out, Arena& arena);
+void bwtDecode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Arena& arena);
@@ -1,5 +1,7 @@
 #include "cli.hpp"
 #include "compressor.hpp"
+#include "stats.hpp"
+#include <filesystem>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
@@ -11,31 +13,68 @@ CLI::CLI(int argc, char* argv[]) {
 
 void CLI::run() const {
     Compressor comp;
+    if (stats || !traceFile.empty()) Stats::enable(!traceFile.empty());
     switch (mode) {
-        case Mode::Compress:
-            std::cout << "[crush] Compressing: " << inputFile
-                      << " -> " << outputFile
-                      << " (algo=" << algoToString(algo)
-                      << ", level=" << compressionLevel
-                      << ", threads=" << threads << ")\n";
-            comp.compress(inputFile, outputFile, algo, compressionLevel, threads);
+        case Mode::Compress: {
+            const bool multi = inputFiles.size() > 1 || std::filesystem::is_directory(inputFile);
+            std::ostream& log = Compressor::statusStream(outputFile);
+            log << "[crush] Compressing: ";
+            for (const std::string& in : inputFiles) log << in << ' ';
+            log << "-> " << outputFile
+                << " (algo=" << algoToString(algo)
+                << ", level=" << compressionLevel
+                << ", threads=" << threads
+                << ", block=" << (blockSize ? blockSize : Compressor::defaultBlockSize(compressionLevel))
+                << ")\n";
+            if (multi) comp.compressFiles(inputFiles, outputFile, algo, compressionLevel, threads, blockSize);
+            else comp.compress(inputFile, outputFile, algo, compressionLevel, threads, blockSize);
             break;
+        }
         case Mode::Decompress:
-            std::cout << "[crush] Decompressing: " << inputFile
-                      << " -> " << outputFile << "\n";
-            comp.decompress(inputFile, outputFile);
+            Compressor::statusStream(outputFile) << "[crush] Decompressing: " << inputFile
+                      << " -> " << outputFile
+                      << " (threads=" << threads << ")\n";
+            comp.decompress(inputFile, outputFile, threads);
+            break;
+        case Mode::Extract: {
+            std::ostream& log = Compressor::statusStream(outputFile);
+            if (!extractEntries.empty()) {
+                log << "[crush] Extracting: " << inputFile << " -> " << outputFile << " (" << extractEntries.size()
+                    << " entr" << (extractEntries.size() == 1 ? "y" : "ies") << ", threads=" << threads << ")\n";
+                comp.unpack(inputFile, outputFile, extractEntries, threads);
+                break;
+            }
+            log << "[crush] Extracting: " << inputFile << " -> " << outputFile << " (offset=" << extractOffset;
+            if (extractLength != std::numeric_limits<uint64_t>::max()) log << ", length=" << extractLength;
+            log << ", threads=" << threads << ")\n";
+            comp.extract(inputFile, outputFile, extractOffset, extractLength, threads);
+            break;
+        }
+        case Mode::List:
+            comp.list(inputFile, std::cout);
             break;
-        case Mode::Benchmark:
-            std::cout << "[crush] Benchmark: " << inputFile
-                      << " (algo=" << algoToString(algo) << ")\n";
-            comp.benchmark(inputFile, algo);
+        case Mode::Benchmark: {
+            // Keep stdout clean for machine-readable formats
+            BenchmarkOptions opts = benchmarkOptions();
+            (opts.format == "table" ? std::cout : std::cerr)
+                      << "[crush] Benchmark: " << inputFile
+                      << " (algo=" << (algo == Algorithm::None ? "all" : algoToString(algo))
+                      << ", iterations=" << opts.iterations << ")\n";
+            comp.benchmark(inputFile, opts);
             break;
+        }
         case Mode::Help:
             printHelp();
             break;
         default:
             throw std::invalid_argument("invalid command. use --help");
     }
+
+    if (stats) {
+        const bool quietStdout = outputFile == "-" || (mode == Mode::Benchmark && benchFormat != "table");
+        Stats::report(quietStdout ? std::cerr : std::cout);
+    }
+    if (!traceFile.empty()) Stats::writeTrace(traceFile);
 }
 
 void CLI::parse(int argc, char* argv[]) {
@@ -46,15 +85,38 @@ void CLI::parse(int argc, char* argv[]) {
     for (size_t i = 0; i < args.size(); ++i) {
         const std::string &a = args[i];
         if (a == "compress" || a == "-c") {
-            if (i + 2 >= args.size()) throw std::invalid_argument("-c requires <input> <output>");
+            // Every operand up to the next option; the last one is the output
             mode = Mode::Compress;
-            inputFile = args[++i];
-            outputFile = args[++i];
+            size_t j = i + 1;
+            while (j < args.size() && (args[j] == "-" || args[j].empty() || args[j][0] != '-')) ++j;
+            if (j - i < 3) throw std::invalid_argument("-c requires <input>... <output>");
+            inputFiles.assign(args.begin() + i + 1, args.begin() + j - 1);
+            inputFile = inputFiles.front();
+            outputFile = args[j - 1];
+            i = j - 1;
         } else if (a == "decompress" || a == "-d") {
             if (i + 2 >= args.size()) throw std::invalid_argument("-d requires <archive> <output_dir>");
             mode = Mode::Decompress;
             inputFile = args[++i];
             outputFile = args[++i];
+        } else if (a == "extract") {
+            if (i + 2 >= args.size()) throw std::invalid_argument("extract requires <archive> <output>");
+            mode = Mode::Extract;
+            inputFile = args[++i];
+            outputFile = args[++i];
+        } else if (a == "list" || a == "-l") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("list requires <archive>");
+            mode = Mode::List;
+            inputFile = args[++i];
+        } else if (a == "--entry") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--entry requires <path>");
+            extractEntries.push_back(args[++i]);
+        } else if (a == "--offset") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--offset requires <bytes>[K|M|G]");
+            extractOffset = parseSize(args[++i]);
+        } else if (a == "--length") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--length requires <bytes>[K|M|G]");
+            extractLength = parseSize(args[++i]);
         } else if (a == "-b") {
             if (i + 1 >= args.size()) throw std::invalid_argument("-b requires <input>");
             mode = Mode::Benchmark;
@@ -67,10 +129,37 @@ void CLI::parse(int argc, char* argv[]) {
             if (i + 1 >= args.size()) throw std::invalid_argument("-level requires <1-9>");
             compressionLevel = std::stoi(args[++i]);
             if (compressionLevel < 1 || compressionLevel > 9) throw std::invalid_argument("level must be 1..9");
+            levelGiven = true;
+        } else if (a == "--levels") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--levels requires <a-b|a,b,...>");
+            benchLevels = parseLevels(args[++i]);
+        } else if (a == "--iters") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--iters requires <num>");
+            benchIterations = std::stoi(args[++i]);
+            if (benchIterations < 1) throw std::invalid_argument("--iters must be >= 1");
+        } else if (a == "--warmup") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--warmup requires <num>");
+            benchWarmup = std::stoi(args[++i]);
+            if (benchWarmup < 0) throw std::invalid_argument("--warmup must be >= 0");
+        } else if (a == "--format") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--format requires <table|csv|json>");
+            benchFormat = args[++i];
+            if (benchFormat != "table" && benchFormat != "csv" && benchFormat != "json")
+                throw std::invalid_argument("format must be table, csv or json");
         } else if (a == "-p" || a == "--threads") {
             if (i + 1 >= args.size()) throw std::invalid_argument("-p requires <num>");
             threads = std::stoi(args[++i]);
             if (threads < 1) threads = 1;
+        } else if (a == "--block-size") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--block-size requires <bytes>[K|M]");
+            blockSize = parseSize(args[++i]);
+            if (blockSize < (1u << 10) || blockSize > (256u << 20))
+                throw std::invalid_argument("block size must be 1K..256M");
+        } else if (a == "--stats") {
+            stats = true;
+        } else if (a == "--trace") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--trace requires <file.json>");
+            traceFile = args[++i];
         } else if (a == "--help" || a == "-h") {
             mode = Mode::Help;
         } else {
@@ -80,8 +169,19 @@ void CLI::parse(int argc, char* argv[]) {
         }
     }
 
-    if (mode == Mode::Compress || mode == Mode::Benchmark) {
+    // Benchmark leaves algo unset to mean "all of them"
+    if (mode == Mode::Compress) {
         if (algo == Algorithm::None) algo = Algorithm::Huffman;
+        for (const std::string& in : inputFiles) {
+            if (in == "-" && inputFiles.size() > 1) throw std::invalid_argument("stdin cannot be archived with other inputs");
+        }
+    }
+#ifdef CRUSH_NO_STATS
+    if (stats || !traceFile.empty()) throw std::invalid_argument("--stats/--trace need a build with CRUSH_STATS=ON");
+#endif
+    if (mode == Mode::Extract && !extractEntries.empty()) {
+        if (extractOffset != 0 || extractLength != std::numeric_limits<uint64_t>::max())
+            throw std::invalid_argument("use either --entry or --offset/--length");
     }
 }
 
@@ -90,15 +190,60 @@ Algorithm CLI::parseAlgo(const std::string& arg) {
     if (arg == "lz77") return Algorithm::LZ77;
     if (arg == "bwt") return Algorithm::BWT;
     if (arg == "arith") return Algorithm::Arithmetic;
+    if (arg == "auto") return Algorithm::Auto;
     return Algorithm::None;
 }
 
+size_t CLI::parseSize(const std::string& arg) {
+    size_t idx = 0;
+    unsigned long long v = std::stoull(arg, &idx);
+    std::string suffix = arg.substr(idx);
+    if (suffix == "K" || suffix == "k") v <<= 10;
+    else if (suffix == "M" || suffix == "m") v <<= 20;
+    else if (suffix == "G" || suffix == "g") v <<= 30;
+    else if (!suffix.empty()) throw std::invalid_argument("bad size suffix: " + suffix);
+    return static_cast<size_t>(v);
+}
+
+std::vector<int> CLI::parseLevels(const std::string& arg) {
+    std::vector<int> levels;
+    size_t dash = arg.find('-');
+    if (dash != std::string::npos) {
+        int lo = std::stoi(arg.substr(0, dash)), hi = std::stoi(arg.substr(dash + 1));
+        for (int l = lo; l <= hi; ++l) levels.push_back(l);
+    } else {
+        std::stringstream ss(arg);
+        std::string item;
+        while (std::getline(ss, item, ',')) levels.push_back(std::stoi(item));
+    }
+    if (levels.empty()) throw std::invalid_argument("empty level list");
+    for (int l : levels)
+        if (l < 1 || l > 9) throw std::invalid_argument("level must be 1..9");
+    return levels;
+}
+
+BenchmarkOptions CLI::benchmarkOptions() const {
+    BenchmarkOptions opts;
+    if (algo != Algorithm::None) opts.algos = {algo};
+    opts.levels = levelGiven ? std::vector<int>{compressionLevel} : benchLevels;
+    // Powers of two up to -p, plus -p itself
+    opts.threads.clear();
+    for (int t = 1; t < threads; t *= 2) opts.threads.push_back(t);
+    opts.threads.push_back(threads);
+    opts.blockSize = blockSize;
+    opts.warmup = benchWarmup;
+    opts.iterations = benchIterations;
+    opts.format = benchFormat;
+    return opts;
+}
+
 std::string CLI::algoToString(Algorithm a) {
     switch (a) {
         case Algorithm::Huffman: return "Huffman";
         case Algorithm::LZ77: return "LZ77";
         case Algorithm::BWT: return "BWT";
         case Algorithm::Arithmetic: return "Arithmetic";
+        case Algorithm::Auto: return "Auto";
         default: return "None";
     }
 }
@@ -107,11 +252,24 @@ void CLI::printHelp() const {
     std::cout <<
     "Crush - Phase3 CLI\n\n"
     "Usage:\n"
-    "  crush compress <input> <output> [-a <algo>] [--level N] [-p threads]\n"
-    "  crush decompress <archive> <output_dir>\n"
-    "  crush -b <input> -a <algo>\n\n"
-    "Algorithms: huff | lz77 | bwt | arith\n"
+    "  crush compress <input>... <output> [-a <algo>] [--level N] [-p threads] [--block-size N[K|M]]\n"
+    "  crush decompress <archive> <output_dir> [-p threads]\n"
+    "  crush extract <archive> <output> --offset N[K|M|G] [--length N[K|M|G]] [-p threads]\n"
+    "  crush extract <archive> <output_dir> --entry <path> [--entry <path>...] [-p threads]\n"
+    "  crush list <archive>\n"
+    "  crush -b <input> [-a <algo>] [--levels 1-9|1,5,9] [-p max_threads]\n"
+    "           [--iters N] [--warmup N] [--format table|csv|json]\n"
+    "  Use - as <input>/<output> for stdin/stdout, e.g. tar c dir | crush compress - - > dir.crush\n"
+    "  Several inputs or a directory make a multi-file archive; decompress unpacks it into <output_dir>\n"
+    "  Any command takes --stats (per-stage timings and counters) and --trace <file.json> (Chrome trace)\n\n"
+    "Algorithms: huff | lz77 | bwt | arith | auto (chosen per block)\n"
     "Examples:\n"
     "  crush compress file.txt file.crush -a huff --level 6 -p 4\n"
-    "  crush decompress file.crush ./outdir\n";
+    "  crush compress mixed.tar mixed.crush -a auto -p 4\n"
+    "  crush decompress file.crush ./outdir\n"
+    "  crush compress photos/ notes.txt backup.crush -a auto -p 8\n"
+    "  crush extract backup.crush ./restore --entry photos/2026 -p 8\n"
+    "  crush extract app.log.crush - --offset 1G --length 64K | tail\n"
+    "  crush -b corpus.txt --levels 1-9 -p 8 --format csv > bench.csv\n"
+    "  crush compress big.log big.crush -a lz77 -p 8 --stats --trace big.json\n";
 }
@@ -1,8 +1,11 @@
 #pragma once
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <vector>
 #include "compressor.hpp"
 
-enum class Mode { Compress, Decompress, Benchmark, Help, Invalid };
+enum class Mode { Compress, Decompress, Extract, List, Benchmark, Help, Invalid };
 
 class CLI {
 public:
@@ -13,12 +16,27 @@ private:
     Mode mode{Mode::Invalid};
     Algorithm algo{Algorithm::None};
     std::string inputFile;
+    std::vector<std::string> inputFiles;  // compress: several inputs or a directory make a multi-file archive
     std::string outputFile;
     int compressionLevel{5};
     int threads{1};
+    size_t blockSize{0};
+    bool levelGiven{false};
+    uint64_t extractOffset{0};
+    uint64_t extractLength{std::numeric_limits<uint64_t>::max()};
+    std::vector<std::string> extractEntries;
+    std::vector<int> benchLevels{1, 5, 9};
+    int benchIterations{5};
+    int benchWarmup{1};
+    std::string benchFormat{"table"};
+    bool stats{false};
+    std::string traceFile;
 
     void parse(int argc, char* argv[]);
     static Algorithm parseAlgo(const std::string& arg);
+    static size_t parseSize(const std::string& arg);
+    static std::vector<int> parseLevels(const std::string& arg);
+    BenchmarkOptions benchmarkOptions() const;
     static std::string algoToString(Algorithm a);
     void printHelp() const;
 };
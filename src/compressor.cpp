@@ -1,101 +1,487 @@
 #include "compressor.hpp"
+#include "analyze.hpp"
+#include "arena.hpp"
+#include "bitio.hpp"
+#include "bwt.hpp"
+#include "directory.hpp"
+#include "fileio.hpp"
+#include "huffman.hpp"
+#include "lz77.hpp"
+#include "pipeline.hpp"
+#include "rans.hpp"
+#include "stats.hpp"
+#include "xxhash.hpp"
 #include <iostream>
+#include <iomanip>
+#include <filesystem>
 #include <fstream>
 #include <vector>
-#include <map>
-#include <bitset>
-#include <queue>
 #include <algorithm>
 #include <string>
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
-// ===== Huffman helpers =====
-struct HuffmanNode {
-    char c;
-    int freq;
-    HuffmanNode *left = nullptr, *right = nullptr;
+// ===== Container format =====
+// Archive layout (all container integers little-endian):
+//   header:  "CRSH" | version u8 | algo u8 | level u8 | flags u8 | blockSize u32
+//   dir:     central directory (directory.hpp), only with kFlagDirectory
+//   blocks:  rawSize u32 | compSize u32 | xxh32(raw) u32 | codec u8 | payload[compSize]
+//   end:     one all-zero block header
+//   index:   compSize u32 | rawSize u32 | xxh32(raw) u32, one entry per block
+//   footer:  blockCount u32 | xxh32(index) u32 | totalRaw u64 | "CRSX"
+// Every block is coded independently so blocks can be (de)compressed in
+// parallel. `codec` is the archive's algorithm, the per-block choice of an
+// auto archive, or Stored for a block kept raw because coding it did not
+// pay. A stream can be written and read front to back; the trailing
+// index lets a seekable reader locate every block from the footer alone.
+// A multi-file archive is the same block stream over the concatenated
+// file contents, with the directory mapping paths to ranges of it.
+static const char kMagic[4] = {'C', 'R', 'S', 'H'};
+static const char kFooterMagic[4] = {'C', 'R', 'S', 'X'};
+static const uint8_t kFormatVersion = 3;
+static const uint8_t kFlagDirectory = 1;
+static const size_t kHeaderSize = 4 + 1 + 1 + 1 + 1 + 4;
+static const size_t kBlockHeaderSize = 4 + 4 + 4 + 1;
+static const size_t kIndexEntrySize = 4 + 4 + 4;
+static const size_t kFooterSize = 4 + 4 + 8 + 4;
 
-    HuffmanNode(char ch, int f) : c(ch), freq(f) {}
-    HuffmanNode(HuffmanNode* l, HuffmanNode* r) : c(0), freq(l->freq+r->freq), left(l), right(r) {}
+const char* algorithmName(Algorithm algo) {
+    switch (algo) {
+        case Algorithm::Huffman: return "huff";
+        case Algorithm::LZ77: return "lz77";
+        case Algorithm::BWT: return "bwt";
+        case Algorithm::Arithmetic: return "arith";
+        case Algorithm::Stored: return "stored";
+        case Algorithm::Auto: return "auto";
+        default: return "none";
+    }
+}
+
+size_t Compressor::defaultBlockSize(int level) {
+    // Larger blocks give the coders more context at the cost of latency/memory.
+    static const size_t kSizes[9] = {
+        256u << 10, 256u << 10, 512u << 10, 512u << 10, 1u << 20,
+        1u << 20, 2u << 20, 4u << 20, 8u << 20
+    };
+    return kSizes[std::clamp(level, 1, 9) - 1];
+}
+
+static void encodeBlock(const uint8_t* src, size_t n, Algorithm algo, int level, std::vector<uint8_t>& out, Arena& arena) {
+    switch (algo) {
+        case Algorithm::Huffman:
+            huffmanEncode(src, n, out);
+            break;
+        case Algorithm::LZ77:
+            lz77Encode(src, n, level, out, arena);
+            break;
+        case Algorithm::BWT:
+            bwtEncode(src, n, out, arena);
+            break;
+        case Algorithm::Arithmetic: {
+            int order = ransOrderForLevel(level, n);
+            size_t start = out.size();
+            ransEncode(src, n, order, out, arena);
+            if (order) {
+                // Order-1 tables do not always pay for themselves; code
+                // order-0 behind it and keep the smaller one
+                size_t mid = out.size();
+                ransEncode(src, n, 0, out, arena);
+                if (out.size() - mid < mid - start) {
+                    std::memmove(out.data() + start, out.data() + mid, out.size() - mid);
+                    out.resize(start + (out.size() - mid));
+                } else {
+                    out.resize(mid);
+                }
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown algorithm");
+    }
+}
+
+static void decodeBlock(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Algorithm algo, Arena& arena) {
+    switch (algo) {
+        case Algorithm::Huffman:
+            huffmanDecode(src, n, dst, rawSize);
+            break;
+        case Algorithm::LZ77:
+            lz77Decode(src, n, dst, rawSize, arena);
+            break;
+        case Algorithm::BWT:
+            bwtDecode(src, n, dst, rawSize, arena);
+            break;
+        case Algorithm::Arithmetic:
+            ransDecode(src, n, dst, rawSize, arena);
+            break;
+        case Algorithm::Stored:
+            if (n != rawSize) throw std::runtime_error("Corrupt stored block");
+            std::memcpy(dst, src, n);
+            break;
+        default:
+            throw std::runtime_error("Unknown algorithm");
+    }
+}
+
+// ===== Stream helpers =====
+// "-" selects stdin/stdout so crush can sit in a pipe.
+static std::istream& openInput(const std::string& path, std::ifstream& file) {
+    if (path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return std::cin;
+    }
+    file.open(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open input file");
+    return file;
+}
+
+static std::ostream& openOutput(const std::string& path, std::ofstream& file) {
+    if (path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        return std::cout;
+    }
+    file.open(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open output file");
+    return file;
+}
+
+std::ostream& Compressor::statusStream(const std::string& output) {
+    return output == "-" ? std::cerr : std::cout;
+}
+
+// Reads up to n bytes; returns the count actually read (short only at EOF).
+static size_t readFully(std::istream& in, uint8_t* dst, size_t n) {
+    in.read(reinterpret_cast<char*>(dst), std::streamsize(n));
+    if (in.bad()) throw std::runtime_error("Failed reading input");
+    return size_t(in.gcount());
+}
+
+// Slots in flight: enough to keep every worker busy while one block is
+// being read and one written.
+static size_t pipelineDepth(int threads) { return size_t(std::max(threads, 1)) + 2; }
+
+// ===== Shared archive plumbing =====
+// `data` points at the block's input: into the caller's buffer for the
+// in-memory API, or at the slot's own copy when streaming.
+struct EncodeSlot {
+    size_t seq = 0;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> raw, comp;
+    Arena arena;
 };
 
-struct CompareNode {
-    bool operator()(HuffmanNode* a, HuffmanNode* b) { return a->freq > b->freq; }
+struct DecodeSlot {
+    size_t seq = 0;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    uint8_t* dst = nullptr;
+    size_t rawSize = 0;
+    uint32_t checksum = 0;
+    Algorithm codec = Algorithm::None;
+    std::vector<uint8_t> comp, raw;
+    Arena arena;
 };
 
-void buildCodes(HuffmanNode* node, const std::string& prefix, std::map<char,std::string>& codes) {
-    if (!node) return;
-    if (!node->left && !node->right) codes[node->c] = prefix;
-    buildCodes(node->left, prefix+"0", codes);
-    buildCodes(node->right, prefix+"1", codes);
+// One block as recorded in the block header and in the trailing index.
+struct BlockEntry {
+    uint32_t compSize;
+    uint32_t rawSize;
+    uint32_t checksum;
+};
+
+static bool sameEntry(const BlockEntry& a, const BlockEntry& b) {
+    return a.compSize == b.compSize && a.rawSize == b.rawSize && a.checksum == b.checksum;
 }
 
-void freeTree(HuffmanNode* node) {
-    if (!node) return;
-    freeTree(node->left);
-    freeTree(node->right);
-    delete node;
+static void writeHeader(std::vector<uint8_t>& out, Algorithm algo, int level, size_t blockSize, uint8_t flags = 0) {
+    out.insert(out.end(), kMagic, kMagic + 4);
+    out.push_back(kFormatVersion);
+    out.push_back(uint8_t(algo));
+    out.push_back(uint8_t(level));
+    out.push_back(flags);
+    putU32(out, uint32_t(blockSize));
 }
 
-// ===== LZ77 helpers =====
-struct LZ77Token {
-    int offset;
-    int length;
-    char next;
-};
+static Algorithm parseHeader(const uint8_t* header, size_t size, size_t& blockSize, uint8_t& flags) {
+    if (size < 4 || std::memcmp(header, kMagic, 4) != 0)
+        throw std::runtime_error("Not a crush archive");
+    if (size < kHeaderSize) throw std::runtime_error("Truncated archive");
+    if (header[4] != kFormatVersion)
+        throw std::runtime_error("Unsupported archive version " + std::to_string(header[4]));
+    Algorithm algo = static_cast<Algorithm>(header[5]);
+    if (algo >= Algorithm::None) throw std::runtime_error("Unknown algorithm in archive");
+    flags = header[7];
+    if (flags & ~kFlagDirectory) throw std::runtime_error("Corrupt archive header");
+    blockSize = getU32(header + 8);
+    if (blockSize == 0) throw std::runtime_error("Corrupt archive header");
+    return algo;
+}
 
-// Simple LZ77 encode with fixed window size
-std::vector<LZ77Token> lz77Compress(const std::vector<char>& data, int windowSize=2048, int lookahead=32) {
-    std::vector<LZ77Token> tokens;
-    size_t pos = 0;
-    while (pos < data.size()) {
-        int matchLen = 0;
-        int matchOffset = 0;
-        int start = std::max<int>(0, pos - windowSize);
-        for (int i = start; i < pos; ++i) {
-            int len = 0;
-            while (len < lookahead && pos+len < data.size() && data[i+len] == data[pos+len]) ++len;
-            if (len > matchLen) { matchLen = len; matchOffset = pos-i; }
+// Codec of a block from its header byte; it must be one the archive's
+// algorithm can produce.
+static Algorithm blockCodec(uint8_t byte, Algorithm algo) {
+    Algorithm codec = static_cast<Algorithm>(byte);
+    if (codec == Algorithm::Stored || codec == algo || (algo == Algorithm::Auto && codec < Algorithm::Stored))
+        return codec;
+    throw std::runtime_error("Corrupt block header");
+}
+
+// End marker, index and footer; `entries` lists the blocks in order.
+static void writeTrailer(std::vector<uint8_t>& out, const BlockEntry* entries, size_t count) {
+    out.insert(out.end(), kBlockHeaderSize, 0);
+    size_t indexStart = out.size();
+    uint64_t totalRaw = 0;
+    for (size_t i = 0; i < count; ++i) {
+        putU32(out, entries[i].compSize);
+        putU32(out, entries[i].rawSize);
+        putU32(out, entries[i].checksum);
+        totalRaw += entries[i].rawSize;
+    }
+    uint32_t indexChecksum = xxh32(out.data() + indexStart, out.size() - indexStart);
+    putU32(out, uint32_t(count));
+    putU32(out, indexChecksum);
+    putU64(out, totalRaw);
+    out.insert(out.end(), kFooterMagic, kFooterMagic + 4);
+}
+
+// Block count from a footer; throws unless it is a well-formed one.
+static size_t parseFooter(const uint8_t* footer) {
+    if (std::memcmp(footer + kFooterSize - 4, kFooterMagic, 4) != 0)
+        throw std::runtime_error("Corrupt archive footer");
+    return getU32(footer);
+}
+
+// Decodes and verifies the index stored in front of `footer` into
+// entries[0 .. count).
+static void parseIndex(const uint8_t* index, const uint8_t* footer, size_t blockSize, BlockEntry* entries) {
+    size_t count = getU32(footer);
+    if (xxh32(index, count * kIndexEntrySize) != getU32(footer + 4))
+        throw std::runtime_error("Corrupt archive index");
+    uint64_t totalRaw = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* p = index + i * kIndexEntrySize;
+        entries[i] = {getU32(p), getU32(p + 4), getU32(p + 8)};
+        // Encoding stores any block that does not shrink, so compSize <= rawSize
+        if (entries[i].rawSize == 0 || entries[i].rawSize > blockSize || entries[i].compSize > entries[i].rawSize)
+            throw std::runtime_error("Corrupt archive index");
+        totalRaw += entries[i].rawSize;
+    }
+    if (totalRaw != getU64(footer + 8)) throw std::runtime_error("Corrupt archive index");
+}
+
+// Where the index of a `count`-block archive of `archiveSize` bytes, with
+// blocks from `dataStart` on, starts.
+static uint64_t indexOffset(uint64_t archiveSize, uint64_t dataStart, size_t count) {
+    const uint64_t minimum = dataStart + kBlockHeaderSize + kFooterSize;
+    if (count > (archiveSize - minimum) / (kIndexEntrySize + kBlockHeaderSize))
+        throw std::runtime_error("Corrupt archive index");
+    return archiveSize - kFooterSize - uint64_t(count) * kIndexEntrySize;
+}
+
+// Archive offset of every block header, from the index alone; the blocks
+// must exactly fill the space between `dataStart` and the end marker.
+static void blockOffsets(const BlockEntry* entries, size_t count, uint64_t dataStart, uint64_t indexStart,
+                         uint64_t* offsets) {
+    uint64_t pos = dataStart;
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i] = pos;
+        pos += kBlockHeaderSize + entries[i].compSize;
+    }
+    if (pos + kBlockHeaderSize != indexStart) throw std::runtime_error("Corrupt archive index");
+}
+
+// Offset of the first block of an in-memory archive: past the header and,
+// in a multi-file archive, the directory.
+static size_t dataStartOf(const uint8_t* src, size_t n, uint8_t flags) {
+    if (!(flags & kFlagDirectory)) return kHeaderSize;
+    if (n < kHeaderSize + kDirectoryHeaderSize) throw std::runtime_error("Truncated archive");
+    size_t bytes = directoryBytes(src + kHeaderSize);
+    if (bytes > n - kHeaderSize - kDirectoryHeaderSize) throw std::runtime_error("Truncated archive");
+    return kHeaderSize + kDirectoryHeaderSize + bytes;
+}
+
+// Index of a complete in-memory archive, with every block header checked
+// against it. entries/offsets are carved from `arena`; returns the count.
+static size_t readArchiveIndex(const uint8_t* src, size_t n, size_t dataStart, size_t blockSize, Arena& arena,
+                               BlockEntry*& entries, uint64_t*& offsets) {
+    if (n < dataStart + kBlockHeaderSize + kFooterSize) throw std::runtime_error("Truncated archive");
+    const uint8_t* footer = src + n - kFooterSize;
+    size_t count = parseFooter(footer);
+    const size_t indexStart = size_t(indexOffset(n, dataStart, count));
+    entries = arena.alloc<BlockEntry>(count);
+    offsets = arena.alloc<uint64_t>(count);
+    parseIndex(src + indexStart, footer, blockSize, entries);
+    blockOffsets(entries, count, dataStart, indexStart, offsets);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* p = src + offsets[i];
+        if (!sameEntry({getU32(p + 4), getU32(p), getU32(p + 8)}, entries[i]))
+            throw std::runtime_error("Archive index does not match block " + std::to_string(i));
+    }
+    const uint8_t* endMarker = src + indexStart - kBlockHeaderSize;
+    if (getU32(endMarker) || getU32(endMarker + 4) || getU32(endMarker + 8) || endMarker[12])
+        throw std::runtime_error("Corrupt archive index");
+    return count;
+}
+
+// Appends one framed block (rawSize | compSize | checksum | codec | payload).
+// A block that does not shrink is stored raw instead, so no block grows by
+// more than its header.
+static BlockEntry encodeFramed(const uint8_t* data, size_t size, size_t seq, Algorithm algo, int level,
+                               std::vector<uint8_t>& out, Arena& arena) {
+    size_t at = out.size();
+    out.insert(out.end(), kBlockHeaderSize, 0);
+    Algorithm codec = algo;
+    if (algo == Algorithm::Auto) {
+        StageTimer timer(Stage::Analyze, seq, size);
+        codec = pickAlgorithm(profileBlock(data, size, level, arena), level);
+    }
+    if (codec != Algorithm::Stored) {
+        encodeBlock(data, size, codec, level, out, arena);
+        if (out.size() - at - kBlockHeaderSize >= size) {
+            out.resize(at + kBlockHeaderSize);
+            codec = Algorithm::Stored;
         }
-        char nextChar = (pos + matchLen < data.size()) ? data[pos+matchLen] : 0;
-        tokens.push_back({matchOffset, matchLen, nextChar});
-        pos += matchLen + 1;
     }
-    return tokens;
+    if (codec == Algorithm::Stored) out.insert(out.end(), data, data + size);
+    uint32_t checksum;
+    {
+        StageTimer timer(Stage::Checksum, seq, size);
+        checksum = xxh32(data, size);
+    }
+    BlockEntry e{uint32_t(out.size() - at - kBlockHeaderSize), uint32_t(size), checksum};
+    storeU32(out.data() + at, e.rawSize);
+    storeU32(out.data() + at + 4, e.compSize);
+    storeU32(out.data() + at + 8, e.checksum);
+    out[at + 12] = uint8_t(codec);
+    Stats::count(Counter::Blocks, 1);
+    Stats::count(Counter::BytesIn, size);
+    Stats::count(Counter::BytesOut, out.size() - at);
+    if (codec == Algorithm::Stored) Stats::count(Counter::StoredBlocks, 1);
+    return e;
 }
 
-// Simple LZ77 decode
-std::vector<char> lz77Decompress(const std::vector<LZ77Token>& tokens) {
-    std::vector<char> result;
-    for (auto &t : tokens) {
-        size_t start = result.size() - t.offset;
-        for (int i=0;i<t.length;++i) result.push_back(result[start+i]);
-        if (t.next != 0) result.push_back(t.next);
+// Decodes one block and checks it against its checksum.
+static void decodeChecked(const uint8_t* src, size_t n, uint8_t* dst, const BlockEntry& e,
+                          size_t seq, Algorithm codec, Arena& arena) {
+    decodeBlock(src, n, dst, e.rawSize, codec, arena);
+    StageTimer timer(Stage::Checksum, seq, e.rawSize);
+    if (xxh32(dst, e.rawSize) != e.checksum)
+        throw std::runtime_error("Checksum mismatch in block " + std::to_string(seq));
+}
+
+static void encodeSlot(EncodeSlot& s, Algorithm algo, int level) {
+    StageTimer timer(Stage::Encode, s.seq, s.size);
+    s.comp.clear();
+    s.arena.reset();
+    encodeFramed(s.data, s.size, s.seq, algo, level, s.comp, s.arena);
+}
+
+static BlockEntry slotEntry(const EncodeSlot& s) {
+    return {getU32(s.comp.data() + 4), getU32(s.comp.data()), getU32(s.comp.data() + 8)};
+}
+
+static void decodeSlot(DecodeSlot& s) {
+    StageTimer timer(Stage::Decode, s.seq, s.rawSize);
+    s.arena.reset();
+    decodeChecked(s.data, s.size, s.dst, {uint32_t(s.size), uint32_t(s.rawSize), s.checksum}, s.seq, s.codec, s.arena);
+}
+
+// Codecs a block can be recorded with; per-codec counts are indexed by it.
+static const size_t kCodecs = size_t(Algorithm::Auto);
+
+// Block count, plus how the blocks were actually coded when that varies.
+static void reportBlocks(std::ostream& log, const size_t* perCodec, size_t blocks, Algorithm algo) {
+    log << blocks << " block(s)";
+    if (algo != Algorithm::Auto && perCodec[size_t(algo)] == blocks) return;
+    const char* sep = " (";
+    for (size_t c = 0; c < kCodecs; ++c) {
+        if (!perCodec[c]) continue;
+        log << sep << algorithmName(Algorithm(c)) << ' ' << perCodec[c];
+        sep = ", ";
     }
-    return result;
+    if (blocks) log << ')';
 }
 
-// ===== BWT helpers =====
-std::string bwtTransform(const std::string& s) {
-    std::string s2 = s + '\0';
-    std::vector<std::string> rotations;
-    for (size_t i=0;i<s2.size();++i)
-        rotations.push_back(s2.substr(i)+s2.substr(0,i));
-    std::sort(rotations.begin(), rotations.end());
-    std::string result;
-    for (auto &r : rotations) result += r.back();
-    return result;
+// ===== Random access =====
+// What a seekable reader learns from the header, the directory, the
+// footer and the index, before touching any block.
+struct ArchiveLayout {
+    Algorithm algo;
+    size_t blockSize;
+    uint8_t flags;
+    std::vector<DirEntry> directory;
+    std::vector<BlockEntry> entries;
+    std::vector<uint64_t> offsets;   // archive offset of each block header
+    std::vector<uint64_t> rawStart;  // uncompressed offset of each block, then the total
+};
+
+static void readLayout(const RandomAccessFile& file, ArchiveLayout& a) {
+    uint8_t header[kHeaderSize];
+    size_t headerBytes = size_t(std::min<uint64_t>(file.size(), kHeaderSize));
+    file.read(0, header, headerBytes);
+    a.algo = parseHeader(header, headerBytes, a.blockSize, a.flags);
+
+    uint64_t dataStart = kHeaderSize;
+    if (a.flags & kFlagDirectory) {
+        std::vector<uint8_t> dir(kDirectoryHeaderSize);
+        file.read(kHeaderSize, dir.data(), dir.size());
+        size_t bytes = directoryBytes(dir.data());
+        if (bytes > file.size() - kHeaderSize - kDirectoryHeaderSize) throw std::runtime_error("Truncated archive");
+        dir.resize(kDirectoryHeaderSize + bytes);
+        file.read(kHeaderSize + kDirectoryHeaderSize, dir.data() + kDirectoryHeaderSize, bytes);
+        a.directory = parseDirectory(dir.data(), dir.size());
+        dataStart += dir.size();
+    }
+
+    if (file.size() < dataStart + kBlockHeaderSize + kFooterSize) throw std::runtime_error("Truncated archive");
+    uint8_t footer[kFooterSize];
+    file.read(file.size() - kFooterSize, footer, kFooterSize);
+    size_t count = parseFooter(footer);
+    const uint64_t indexStart = indexOffset(file.size(), dataStart, count);
+    std::vector<uint8_t> index(count * kIndexEntrySize);
+    file.read(indexStart, index.data(), index.size());
+    a.entries.resize(count);
+    a.offsets.resize(count);
+    parseIndex(index.data(), footer, a.blockSize, a.entries.data());
+    blockOffsets(a.entries.data(), count, dataStart, indexStart, a.offsets.data());
+
+    a.rawStart.assign(count + 1, 0);
+    for (size_t i = 0; i < count; ++i) a.rawStart[i + 1] = a.rawStart[i] + a.entries[i].rawSize;
+    if (a.flags & kFlagDirectory) {
+        uint64_t total = 0;
+        for (const DirEntry& e : a.directory) total += e.size;
+        if (total != a.rawStart[count]) throw std::runtime_error("Corrupt archive directory");
+    }
 }
 
-std::string bwtInverse(const std::string& s) {
-    size_t n = s.size();
-    std::vector<std::string> table(n);
-    for (size_t i=0;i<n;++i) {
-        for (size_t j=0;j<n;++j) table[j] = s[j] + table[j];
-        std::sort(table.begin(), table.end());
+// Loads block i straight from the archive file into a decode slot.
+static void readBlock(const RandomAccessFile& file, const ArchiveLayout& a, size_t i, DecodeSlot& s) {
+    const BlockEntry& e = a.entries[i];
+    s.comp.resize(kBlockHeaderSize + e.compSize);
+    {
+        StageTimer timer(Stage::Read, i, s.comp.size());
+        file.read(a.offsets[i], s.comp.data(), s.comp.size());
     }
-    for (auto &row : table)
-        if (row.back() == '\0') return row.substr(0,row.size()-1);
-    return "";
+    const uint8_t* bh = s.comp.data();
+    if (!sameEntry({getU32(bh + 4), getU32(bh), getU32(bh + 8)}, e))
+        throw std::runtime_error("Archive index does not match block " + std::to_string(i));
+    s.codec = blockCodec(bh[12], a.algo);
+    s.raw.resize(e.rawSize);
+    s.seq = i;
+    s.data = s.comp.data() + kBlockHeaderSize;
+    s.size = e.compSize;
+    s.dst = s.raw.data();
+    s.rawSize = e.rawSize;
+    s.checksum = e.checksum;
 }
 
 // ===== Compressor class implementation =====
@@ -103,124 +489,534 @@ void Compressor::compress(const std::string &input,
                           const std::string &output,
                           Algorithm algo,
                           int level,
-                          int threads) {
-    std::ifstream fin(input, std::ios::binary);
-    if (!fin) throw std::runtime_error("Cannot open input file");
-    std::vector<char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-    std::ofstream fout(output, std::ios::binary);
-    if (!fout) throw std::runtime_error("Cannot open output file");
-
-    switch(algo) {
-        case Algorithm::Huffman: {
-            // Huffman (same as Phase 3)
-            std::map<char,int> freq;
-            for (char c : data) freq[c]++;
-            std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, CompareNode> pq;
-            for (auto &p : freq) pq.push(new HuffmanNode(p.first, p.second));
-            while (pq.size() > 1) {
-                HuffmanNode* a = pq.top(); pq.pop();
-                HuffmanNode* b = pq.top(); pq.pop();
-                pq.push(new HuffmanNode(a,b));
+                          int threads,
+                          size_t blockSize) {
+    if (algo >= Algorithm::None) throw std::runtime_error("Unknown algorithm");
+    std::ifstream fileIn;
+    std::istream& in = openInput(input, fileIn);
+    std::ofstream fileOut;
+    std::ostream& out = openOutput(output, fileOut);
+    if (blockSize == 0) blockSize = defaultBlockSize(level);
+
+    std::vector<uint8_t> header;
+    writeHeader(header, algo, level, blockSize);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    std::vector<BlockEntry> entries;
+    size_t perCodec[kCodecs] = {};
+    size_t blocksRead = 0;
+    runPipeline<EncodeSlot>(threads, pipelineDepth(threads),
+        [&](EncodeSlot& s) {
+            StageTimer timer(Stage::Read, blocksRead);
+            s.raw.resize(blockSize);
+            s.raw.resize(readFully(in, s.raw.data(), blockSize));
+            s.seq = blocksRead++;
+            s.data = s.raw.data();
+            s.size = s.raw.size();
+            timer.setBytes(s.size);
+            if (s.size == 0) timer.discard();
+            return s.size != 0;
+        },
+        [&](EncodeSlot& s) { encodeSlot(s, algo, level); },
+        [&](EncodeSlot& s) {
+            StageTimer timer(Stage::Write, s.seq, s.comp.size());
+            out.write(reinterpret_cast<const char*>(s.comp.data()), s.comp.size());
+            if (!out) throw std::runtime_error("Failed writing output file");
+            entries.push_back(slotEntry(s));
+            ++perCodec[s.comp[12]];
+        });
+
+    std::vector<uint8_t> trailer;
+    writeTrailer(trailer, entries.data(), entries.size());
+    out.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    out.flush();
+    if (!out) throw std::runtime_error("Failed writing output file");
+    std::ostream& log = statusStream(output);
+    log << "[compress] done, ";
+    reportBlocks(log, perCodec, entries.size(), algo);
+    log << '\n';
+}
+
+void Compressor::decompress(const std::string &input,
+                            const std::string &output,
+                            int threads) {
+    std::ifstream fileIn;
+    std::istream& in = openInput(input, fileIn);
+
+    uint8_t header[kHeaderSize];
+    size_t blockSize;
+    uint8_t flags;
+    Algorithm algo = parseHeader(header, readFully(in, header, kHeaderSize), blockSize, flags);
+    if (flags & kFlagDirectory) {
+        // File contents are only located through the directory and the
+        // index, which need a seekable archive
+        if (input == "-") throw std::runtime_error("Multi-file archives cannot be read from stdin");
+        fileIn.close();
+        unpack(input, output, {}, threads);
+        return;
+    }
+
+    std::ofstream fileOut;
+    std::ostream& out = openOutput(output, fileOut);
+
+    // Blocks are framed with their sizes, so the stream can be consumed
+    // one block at a time without seeking. The index is checked against
+    // the headers seen on the way instead of being read first.
+    std::vector<BlockEntry> seen;
+    runPipeline<DecodeSlot>(threads, pipelineDepth(threads),
+        [&](DecodeSlot& s) {
+            StageTimer timer(Stage::Read, seen.size());
+            uint8_t bh[kBlockHeaderSize];
+            if (readFully(in, bh, kBlockHeaderSize) != kBlockHeaderSize) throw std::runtime_error("Truncated archive");
+            BlockEntry e{getU32(bh + 4), getU32(bh), getU32(bh + 8)};
+            if (e.rawSize == 0) {
+                if (e.compSize != 0 || e.checksum != 0 || bh[12] != 0) throw std::runtime_error("Corrupt block header");
+                timer.discard();
+                return false;
             }
-            HuffmanNode* root = pq.top();
-            std::map<char,std::string> codes;
-            buildCodes(root, "", codes);
-            uint32_t tableSize = freq.size();
-            fout.write(reinterpret_cast<const char*>(&tableSize), sizeof(tableSize));
-            for (auto &p : freq) { fout.put(p.first); uint32_t f = p.second; fout.write(reinterpret_cast<const char*>(&f), sizeof(f)); }
-            std::string bitString;
-            for (char c : data) bitString += codes[c];
-            for (size_t i=0;i<bitString.size();i+=8) {
-                std::string byteStr = bitString.substr(i,8);
-                while(byteStr.size() < 8) byteStr += '0';
-                uint8_t b = std::bitset<8>(byteStr).to_ulong();
-                fout.put(b);
+            if (e.rawSize > blockSize || e.compSize > e.rawSize) throw std::runtime_error("Corrupt block header");
+            s.codec = blockCodec(bh[12], algo);
+            s.raw.resize(e.rawSize);
+            s.comp.resize(e.compSize);
+            if (readFully(in, s.comp.data(), e.compSize) != e.compSize) throw std::runtime_error("Truncated archive");
+            timer.setBytes(kBlockHeaderSize + e.compSize);
+            s.seq = seen.size();
+            s.data = s.comp.data();
+            s.size = e.compSize;
+            s.dst = s.raw.data();
+            s.rawSize = e.rawSize;
+            s.checksum = e.checksum;
+            seen.push_back(e);
+            return true;
+        },
+        [&](DecodeSlot& s) { decodeSlot(s); },
+        [&](DecodeSlot& s) {
+            StageTimer timer(Stage::Write, s.seq, s.rawSize);
+            out.write(reinterpret_cast<const char*>(s.dst), s.rawSize);
+            if (!out) throw std::runtime_error("Failed writing output file");
+        });
+
+    std::vector<uint8_t> trailer(seen.size() * kIndexEntrySize + kFooterSize);
+    if (readFully(in, trailer.data(), trailer.size()) != trailer.size()) throw std::runtime_error("Truncated archive");
+    const uint8_t* footer = trailer.data() + trailer.size() - kFooterSize;
+    if (parseFooter(footer) != seen.size()) throw std::runtime_error("Corrupt archive index");
+    std::vector<BlockEntry> entries(seen.size());
+    parseIndex(trailer.data(), footer, blockSize, entries.data());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!sameEntry(entries[i], seen[i]))
+            throw std::runtime_error("Archive index does not match block " + std::to_string(i));
+    }
+    if (in.peek() != std::char_traits<char>::eof()) throw std::runtime_error("Trailing data after archive");
+
+    out.flush();
+    if (!out) throw std::runtime_error("Failed writing output file");
+    statusStream(output) << "[decompress] done, " << seen.size() << " block(s) verified\n";
+}
+
+void Compressor::compressBuffer(const uint8_t* src, size_t n,
+                                std::vector<uint8_t>& archive,
+                                Algorithm algo,
+                                int level,
+                                int threads,
+                                size_t blockSize) {
+    if (algo >= Algorithm::None) throw std::runtime_error("Unknown algorithm");
+    if (blockSize == 0) blockSize = defaultBlockSize(level);
+    archive.clear();
+    writeHeader(archive, algo, level, blockSize);
+
+    size_t pos = 0;
+    std::vector<BlockEntry> entries;
+    runPipeline<EncodeSlot>(threads, pipelineDepth(threads),
+        [&](EncodeSlot& s) {
+            s.seq = pos / blockSize;
+            s.data = src + pos;
+            s.size = std::min(blockSize, n - pos);
+            pos += s.size;
+            return s.size != 0;
+        },
+        [&](EncodeSlot& s) { encodeSlot(s, algo, level); },
+        [&](EncodeSlot& s) {
+            archive.insert(archive.end(), s.comp.begin(), s.comp.end());
+            entries.push_back(slotEntry(s));
+        });
+    writeTrailer(archive, entries.data(), entries.size());
+}
+
+void Compressor::decompressBuffer(const uint8_t* src, size_t n,
+                                  std::vector<uint8_t>& output,
+                                  int threads) {
+    size_t blockSize;
+    uint8_t flags;
+    Algorithm algo = parseHeader(src, n, blockSize, flags);
+
+    // The footer gives the index, and the index gives every block's offset
+    // and the output size, so all blocks decode straight into place. For a
+    // multi-file archive that is the concatenated file contents.
+    Arena index;
+    BlockEntry* entries;
+    uint64_t* offsets;
+    const size_t count = readArchiveIndex(src, n, dataStartOf(src, n, flags), blockSize, index, entries, offsets);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += entries[i].rawSize;
+    output.resize(total);
+
+    size_t next = 0, outPos = 0;
+    runPipeline<DecodeSlot>(threads, pipelineDepth(threads),
+        [&](DecodeSlot& s) {
+            if (next == count) return false;
+            const BlockEntry& e = entries[next];
+            s.seq = next;
+            s.codec = blockCodec(src[size_t(offsets[next]) + 12], algo);
+            s.data = src + size_t(offsets[next]) + kBlockHeaderSize;
+            s.size = e.compSize;
+            s.dst = output.data() + outPos;
+            s.rawSize = e.rawSize;
+            s.checksum = e.checksum;
+            outPos += e.rawSize;
+            ++next;
+            return true;
+        },
+        [&](DecodeSlot& s) { decodeSlot(s); },
+        [&](DecodeSlot&) {});
+}
+
+void Compressor::extract(const std::string &input,
+                         const std::string &output,
+                         uint64_t offset,
+                         uint64_t length,
+                         int threads) {
+    RandomAccessFile file(input);
+    ArchiveLayout a;
+    readLayout(file, a);
+
+    // Only the footer, the index and the blocks overlapping the range are
+    // ever read from the archive.
+    const size_t count = a.entries.size();
+    const std::vector<uint64_t>& rawStart = a.rawStart;
+    if (offset > rawStart[count])
+        throw std::runtime_error("Offset beyond end of data (" + std::to_string(rawStart[count]) + " bytes)");
+    const uint64_t end = offset + std::min(length, rawStart[count] - offset);
+    size_t next = size_t(std::upper_bound(rawStart.begin(), rawStart.end(), offset) - rawStart.begin()) - 1;
+    const size_t first = next;
+
+    std::ofstream fileOut;
+    std::ostream& out = openOutput(output, fileOut);
+    // An empty range touches no blocks
+    if (end > offset) runPipeline<DecodeSlot>(threads, pipelineDepth(threads),
+        [&](DecodeSlot& s) {
+            if (next >= count || rawStart[next] >= end) return false;
+            readBlock(file, a, next++, s);
+            return true;
+        },
+        [&](DecodeSlot& s) { decodeSlot(s); },
+        [&](DecodeSlot& s) {
+            StageTimer timer(Stage::Write, s.seq, s.rawSize);
+            uint64_t lo = std::max(offset, rawStart[s.seq]) - rawStart[s.seq];
+            uint64_t hi = std::min(end, rawStart[s.seq + 1]) - rawStart[s.seq];
+            out.write(reinterpret_cast<const char*>(s.dst + lo), std::streamsize(hi - lo));
+            if (!out) throw std::runtime_error("Failed writing output file");
+        });
+
+    out.flush();
+    if (!out) throw std::runtime_error("Failed writing output file");
+    statusStream(output) << "[extract] done, " << (end - offset) << " byte(s) from "
+                         << (next - first) << " of " << count << " block(s)\n";
+}
+
+// ===== Multi-file archives =====
+namespace fs = std::filesystem;
+
+// Part of one file that goes into a block.
+struct FilePiece {
+    size_t entry;
+    uint64_t offset;
+    size_t size;
+};
+
+static void readPiece(const DirEntry& e, const FilePiece& piece, std::vector<uint8_t>& out) {
+    std::ifstream in(e.source, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open input file " + e.source);
+    if (piece.offset) in.seekg(std::streamoff(piece.offset));
+    size_t at = out.size();
+    out.resize(at + piece.size);
+    if (readFully(in, out.data() + at, piece.size) != piece.size)
+        throw std::runtime_error("File changed while archiving: " + e.source);
+}
+
+void Compressor::compressFiles(const std::vector<std::string> &inputs,
+                               const std::string &output,
+                               Algorithm algo,
+                               int level,
+                               int threads,
+                               size_t blockSize) {
+    if (algo >= Algorithm::None) throw std::runtime_error("Unknown algorithm");
+    if (blockSize == 0) blockSize = defaultBlockSize(level);
+    size_t skipped;
+    const std::vector<DirEntry> dir = collectEntries(inputs, skipped);
+
+    // Files are packed into blocks in directory order, so small files share
+    // blocks and a big one spans several. A file that fits in one block is
+    // not split across two, which keeps most entries to a single block when
+    // extracted on their own.
+    std::vector<FilePiece> pieces;
+    std::vector<size_t> blockStart{0};  // first piece of each block, then the end
+    size_t fill = 0, files = 0;
+    for (size_t i = 0; i < dir.size(); ++i) {
+        uint64_t left = dir[i].size, offset = 0;
+        files += !dir[i].isDir;
+        if (fill && left > blockSize - fill && left <= blockSize) {
+            blockStart.push_back(pieces.size());
+            fill = 0;
+        }
+        while (left) {
+            size_t take = size_t(std::min<uint64_t>(left, blockSize - fill));
+            pieces.push_back({i, offset, take});
+            offset += take;
+            left -= take;
+            fill += take;
+            if (fill == blockSize) {
+                blockStart.push_back(pieces.size());
+                fill = 0;
             }
-            freeTree(root);
-            std::cout << "[compress] done, Huffman\n";
-            break;
         }
-        case Algorithm::LZ77: {
-            auto tokens = lz77Compress(data);
-            // Simple write: offset, length, next char
-            uint32_t count = tokens.size();
-            fout.write(reinterpret_cast<const char*>(&count), sizeof(count));
-            for (auto &t : tokens) {
-                fout.write(reinterpret_cast<const char*>(&t.offset), sizeof(t.offset));
-                fout.write(reinterpret_cast<const char*>(&t.length), sizeof(t.length));
-                fout.put(t.next);
+    }
+    if (fill) blockStart.push_back(pieces.size());
+    const size_t blocks = blockStart.size() - 1;
+
+    std::ofstream fileOut;
+    std::ostream& out = openOutput(output, fileOut);
+    std::vector<uint8_t> header;
+    writeHeader(header, algo, level, blockSize, kFlagDirectory);
+    writeDirectory(header, dir);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    // Blocks are uniform units of work whichever files they hold; workers
+    // claim them in order, and each opens and reads its own files so the
+    // per-file open/read latency is spread over the threads too.
+    size_t next = 0;
+    std::vector<BlockEntry> entries;
+    size_t perCodec[kCodecs] = {};
+    runPipeline<EncodeSlot>(threads, pipelineDepth(threads),
+        [&](EncodeSlot& s) {
+            if (next == blocks) return false;
+            s.seq = next++;
+            return true;
+        },
+        [&](EncodeSlot& s) {
+            {
+                StageTimer timer(Stage::Read, s.seq);
+                s.raw.clear();
+                for (size_t p = blockStart[s.seq]; p < blockStart[s.seq + 1]; ++p)
+                    readPiece(dir[pieces[p].entry], pieces[p], s.raw);
+                timer.setBytes(s.raw.size());
             }
-            std::cout << "[compress] done, LZ77\n";
-            break;
+            s.data = s.raw.data();
+            s.size = s.raw.size();
+            encodeSlot(s, algo, level);
+        },
+        [&](EncodeSlot& s) {
+            StageTimer timer(Stage::Write, s.seq, s.comp.size());
+            out.write(reinterpret_cast<const char*>(s.comp.data()), s.comp.size());
+            if (!out) throw std::runtime_error("Failed writing output file");
+            entries.push_back(slotEntry(s));
+            ++perCodec[s.comp[12]];
+        });
+
+    std::vector<uint8_t> trailer;
+    writeTrailer(trailer, entries.data(), entries.size());
+    out.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    out.flush();
+    if (!out) throw std::runtime_error("Failed writing output file");
+    std::ostream& log = statusStream(output);
+    log << "[compress] done, " << files << " file(s), " << (dir.size() - files) << " dir(s), ";
+    reportBlocks(log, perCodec, entries.size(), algo);
+    if (skipped) log << ", skipped " << skipped << " special file(s)";
+    log << '\n';
+}
+
+static void writeWholeFile(const fs::path& path, const uint8_t* data, size_t n) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f) throw std::runtime_error("Cannot open output file " + path.string());
+    f.write(reinterpret_cast<const char*>(data), std::streamsize(n));
+    f.close();
+    if (!f) throw std::runtime_error("Failed writing output file " + path.string());
+}
+
+void Compressor::unpack(const std::string &input,
+                        const std::string &outputDir,
+                        const std::vector<std::string> &select,
+                        int threads) {
+    RandomAccessFile file(input);
+    ArchiveLayout a;
+    readLayout(file, a);
+    if (!(a.flags & kFlagDirectory)) throw std::runtime_error("Not a multi-file archive");
+
+    // Selected entries: everything, or the named paths and whatever lies
+    // below a named directory
+    std::vector<std::string> names;
+    for (std::string name : select) {
+        while (name.size() > 1 && name.back() == '/') name.pop_back();
+        names.push_back(name);
+    }
+    std::vector<bool> matched(names.size(), false);
+    auto selected = [&](const std::string& path) {
+        bool take = names.empty();
+        for (size_t k = 0; k < names.size(); ++k) {
+            const std::string& n = names[k];
+            if (path.compare(0, n.size(), n) == 0 && (path.size() == n.size() || path[n.size()] == '/'))
+                take = matched[k] = true;
         }
-        case Algorithm::BWT: {
-            std::string s(data.begin(), data.end());
-            std::string transformed = bwtTransform(s);
-            fout.write(transformed.data(), transformed.size());
-            std::cout << "[compress] done, BWT\n";
-            break;
+        return take;
+    };
+
+    std::vector<std::pair<size_t, uint64_t>> chosen;  // entry, start of its contents
+    uint64_t pos = 0;
+    for (size_t i = 0; i < a.directory.size(); ++i) {
+        const DirEntry& e = a.directory[i];
+        if (selected(e.path)) {
+            if (!safeEntryPath(e.path)) throw std::runtime_error("Unsafe path in archive: " + e.path);
+            chosen.push_back({i, pos});
         }
-        case Algorithm::Arithmetic:
-            // Stub for now
-            fout.write(data.data(), data.size());
-            std::cout << "[compress] stub Arithmetic: copied input\n";
-            break;
-        default:
-            throw std::runtime_error("Unknown algorithm");
+        pos += e.size;
+    }
+    for (size_t k = 0; k < names.size(); ++k) {
+        if (!matched[k]) throw std::runtime_error("No such archive entry: " + select[k]);
     }
-}
 
-void Compressor::decompress(const std::string &input,
-                            const std::string &output) {
-    std::ifstream fin(input, std::ios::binary);
-    if (!fin) throw std::runtime_error("Cannot open input file");
-    std::ofstream fout(output, std::ios::binary);
-    if (!fout) throw std::runtime_error("Cannot open output file");
-
-    // Attempt to detect Huffman (by reading table size)
-    uint32_t tableSize = 0;
-    fin.read(reinterpret_cast<char*>(&tableSize), sizeof(tableSize));
-    if (tableSize > 0 && tableSize < 100000) {
-        // Huffman decompression
-        std::map<char,int> freq;
-        for (uint32_t i=0;i<tableSize;++i) {
-            char c = fin.get();
-            uint32_t f = 0;
-            fin.read(reinterpret_cast<char*>(&f), sizeof(f));
-            freq[c] = f;
+    // Directories and empty files are created up front; files with data are
+    // written as their blocks decode.
+    struct Target {
+        fs::path path;
+        uint64_t start, end;  // range of the concatenated contents
+    };
+    std::vector<Target> targets;
+    const fs::path root(outputDir);
+    fs::create_directories(root);
+    fs::path lastParent;
+    size_t files = 0, dirs = 0;
+    uint64_t bytes = 0;
+    for (const auto& c : chosen) {
+        const DirEntry& e = a.directory[c.first];
+        const fs::path path = root / fs::path(e.path);
+        if (e.isDir) {
+            fs::create_directories(path);
+            ++dirs;
+            continue;
         }
-        std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, CompareNode> pq;
-        for (auto &p : freq) pq.push(new HuffmanNode(p.first, p.second));
-        while (pq.size() > 1) {
-            HuffmanNode* a = pq.top(); pq.pop();
-            HuffmanNode* b = pq.top(); pq.pop();
-            pq.push(new HuffmanNode(a,b));
+        if (path.parent_path() != lastParent) {
+            lastParent = path.parent_path();
+            fs::create_directories(lastParent);
         }
-        HuffmanNode* root = pq.top();
-
-        std::vector<char> encodedBytes((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-        std::string bitString;
-        for (char b : encodedBytes) bitString += std::bitset<8>(b).to_string();
-
-        HuffmanNode* node = root;
-        for (char bit : bitString) {
-            node = (bit=='0') ? node->left : node->right;
-            if (!node->left && !node->right) {
-                fout.put(node->c);
-                node = root;
+        if (e.size == 0) writeWholeFile(path, nullptr, 0);
+        else targets.push_back({path, c.second, c.second + e.size});
+        ++files;
+        bytes += e.size;
+    }
+
+    // Blocks covering the selected files, in order
+    std::vector<size_t> blocks;
+    for (const Target& t : targets) {
+        size_t lo = size_t(std::upper_bound(a.rawStart.begin(), a.rawStart.end(), t.start) - a.rawStart.begin()) - 1;
+        size_t hi = size_t(std::upper_bound(a.rawStart.begin(), a.rawStart.end(), t.end - 1) - a.rawStart.begin()) - 1;
+        for (size_t b = blocks.empty() ? lo : std::max(lo, blocks.back() + 1); b <= hi; ++b) blocks.push_back(b);
+    }
+
+    // Files held whole by one block are written by the worker that decoded
+    // it, so small files are created in parallel. A file spanning blocks is
+    // appended to by the in-order writer, one piece per block.
+    auto overlapping = [&](const DecodeSlot& s) {
+        const uint64_t lo = a.rawStart[s.seq];
+        return std::partition_point(targets.begin(), targets.end(), [&](const Target& t) { return t.end <= lo; });
+    };
+    size_t next = 0;
+    std::ofstream spanning;
+    runPipeline<DecodeSlot>(threads, pipelineDepth(threads),
+        [&](DecodeSlot& s) {
+            if (next == blocks.size()) return false;
+            readBlock(file, a, blocks[next++], s);
+            return true;
+        },
+        [&](DecodeSlot& s) {
+            decodeSlot(s);
+            StageTimer timer(Stage::Write, s.seq);
+            const uint64_t lo = a.rawStart[s.seq], hi = a.rawStart[s.seq + 1];
+            for (auto t = overlapping(s); t != targets.end() && t->start < hi; ++t) {
+                if (t->start >= lo && t->end <= hi) writeWholeFile(t->path, s.dst + (t->start - lo), size_t(t->end - t->start));
             }
-        }
-        freeTree(root);
-        std::cout << "[decompress] done, Huffman\n";
+        },
+        [&](DecodeSlot& s) {
+            StageTimer timer(Stage::Write, s.seq);
+            const uint64_t lo = a.rawStart[s.seq], hi = a.rawStart[s.seq + 1];
+            for (auto t = overlapping(s); t != targets.end() && t->start < hi; ++t) {
+                if (t->start >= lo && t->end <= hi) continue;
+                if (t->start >= lo) {
+                    spanning.open(t->path, std::ios::binary | std::ios::trunc);
+                    if (!spanning) throw std::runtime_error("Cannot open output file " + t->path.string());
+                }
+                const uint64_t from = std::max(t->start, lo), to = std::min(t->end, hi);
+                spanning.write(reinterpret_cast<const char*>(s.dst + (from - lo)), std::streamsize(to - from));
+                if (t->end <= hi) spanning.close();
+                if (!spanning) throw std::runtime_error("Failed writing output file " + t->path.string());
+            }
+        });
+
+    statusStream(outputDir) << (select.empty() ? "[decompress]" : "[extract]") << " done, " << files
+                            << " file(s), " << dirs << " dir(s), " << bytes << " byte(s) from " << blocks.size()
+                            << " of " << a.entries.size() << " block(s)\n";
+}
+
+void Compressor::list(const std::string &input, std::ostream &out) {
+    RandomAccessFile file(input);
+    ArchiveLayout a;
+    readLayout(file, a);
+    const size_t blocks = a.entries.size();
+    if (!(a.flags & kFlagDirectory)) {
+        out << "single-file archive, " << a.rawStart[blocks] << " byte(s) in " << blocks << " block(s)\n";
         return;
     }
+    size_t files = 0;
+    for (const DirEntry& e : a.directory) {
+        out << std::setw(14) << e.size << "  " << e.path << (e.isDir ? "/" : "") << '\n';
+        files += !e.isDir;
+    }
+    out << files << " file(s), " << (a.directory.size() - files) << " dir(s), " << a.rawStart[blocks]
+        << " byte(s) in " << blocks << " block(s)\n";
+}
 
-    // Fallback: just copy (BWT/LZ77/Arithmetic)
-    std::vector<char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-    fout.write(data.data(), data.size());
-    std::cout << "[decompress] done (non-Huffman)\n";
+// ===== Reusable contexts =====
+CompressionContext::CompressionContext(Algorithm algo, int level, size_t blockSize)
+    : algo(algo), level(std::clamp(level, 1, 9)),
+      blockSize(blockSize ? blockSize : Compressor::defaultBlockSize(level)) {
+    if (algo >= Algorithm::None) throw std::runtime_error("Unknown algorithm");
 }
 
-void Compressor::benchmark(const std::string &input, Algorithm algo) {
-    std::cout << "[benchmark] not implemented yet for algo=" << static_cast<int>(algo) << "\n";
+void CompressionContext::compress(const uint8_t* src, size_t n, std::vector<uint8_t>& out) {
+    arena.reset();
+    out.clear();
+    writeHeader(out, algo, level, blockSize);
+    const size_t count = (n + blockSize - 1) / blockSize;
+    BlockEntry* entries = arena.alloc<BlockEntry>(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t pos = i * blockSize;
+        entries[i] = encodeFramed(src + pos, std::min(blockSize, n - pos), i, algo, level, out, arena);
+    }
+    writeTrailer(out, entries, count);
+}
+
+void DecompressionContext::decompress(const uint8_t* src, size_t n, std::vector<uint8_t>& out) {
+    arena.reset();
+    size_t blockSize;
+    uint8_t flags;
+    Algorithm algo = parseHeader(src, n, blockSize, flags);
+    BlockEntry* entries;
+    uint64_t* offsets;
+    const size_t count = readArchiveIndex(src, n, dataStartOf(src, n, flags), blockSize, arena, entries, offsets);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += entries[i].rawSize;
+    out.resize(total);
+    for (size_t i = 0, outPos = 0; i < count; outPos += entries[i].rawSize, ++i) {
+        const uint8_t* block = src + offsets[i];
+        decodeChecked(block + kBlockHeaderSize, entries[i].compSize, out.data() + outPos,
+                      entries[i], i, blockCodec(block[12], algo), arena);
+    }
 }
@@ -1,19 +1,124 @@
 #pragma once
+#include "arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
 #include <string>
+#include <vector>
 
-enum class Algorithm { Huffman, LZ77, BWT, Arithmetic, None };
+// Stored is the raw fallback recorded per block; Auto picks a codec for
+// each block from a sample of its contents.
+enum class Algorithm : uint8_t { Huffman, LZ77, BWT, Arithmetic, Stored, Auto, None };
+
+// Short lower-case name ("huff", "lz77", ...), as accepted by -a.
+const char* algorithmName(Algorithm algo);
+
+// Round-trip benchmark matrix: every algorithm x level x thread count.
+struct BenchmarkOptions {
+    std::vector<Algorithm> algos;   // empty = all
+    std::vector<int> levels{1, 5, 9};
+    std::vector<int> threads{1};
+    size_t blockSize = 0;           // 0 = per-level default
+    int warmup = 1;
+    int iterations = 5;
+    std::string format = "table";   // table | csv | json
+};
 
 class Compressor {
 public:
+    // Input is split into independently coded blocks of `blockSize` bytes
+    // (0 picks a size from `level`) which are spread over `threads` workers.
+    // Both directions stream: memory stays around blockSize x threads, and
+    // "-" as input or output means stdin/stdout.
     void compress(const std::string &input,
                   const std::string &output,
                   Algorithm algo,
                   int level = 5,
-                  int threads = 1);
+                  int threads = 1,
+                  size_t blockSize = 0);
 
+    // A multi-file archive is unpacked into `output` as a directory.
     void decompress(const std::string &input,
-                    const std::string &output);
+                    const std::string &output,
+                    int threads = 1);
+
+    // Multi-file archive of files and directory trees. Contents are packed
+    // into shared blocks behind a central directory, so the blocks of small
+    // and large files alike spread evenly over `threads` workers.
+    void compressFiles(const std::vector<std::string> &inputs,
+                       const std::string &output,
+                       Algorithm algo,
+                       int level = 5,
+                       int threads = 1,
+                       size_t blockSize = 0);
+
+    // Writes the entries of a multi-file archive under `outputDir`, or
+    // only the `select`ed paths and everything below them. Only the blocks
+    // holding those entries are read and decoded.
+    void unpack(const std::string &input,
+                const std::string &outputDir,
+                const std::vector<std::string> &select = {},
+                int threads = 1);
+
+    // Prints the central directory of an archive.
+    void list(const std::string &input, std::ostream &out);
+
+    // In-memory equivalents producing/consuming the same archive format.
+    void compressBuffer(const uint8_t* src, size_t n,
+                        std::vector<uint8_t>& archive,
+                        Algorithm algo,
+                        int level = 5,
+                        int threads = 1,
+                        size_t blockSize = 0);
+
+    void decompressBuffer(const uint8_t* src, size_t n,
+                          std::vector<uint8_t>& output,
+                          int threads = 1);
+
+    // Decodes only the blocks overlapping [offset, offset + length) of the
+    // uncompressed data, located through the archive's block index; the
+    // range is clamped to the end of the data.
+    void extract(const std::string &input,
+                 const std::string &output,
+                 uint64_t offset,
+                 uint64_t length,
+                 int threads = 1);
 
     void benchmark(const std::string &input,
-                   Algorithm algo);
+                   const BenchmarkOptions &options);
+
+    static size_t defaultBlockSize(int level);
+
+    // Where progress messages go: stderr when the data goes to stdout.
+    static std::ostream& statusStream(const std::string& output);
+};
+
+// ===== Reusable contexts =====
+// Buffer-to-buffer API for many small inputs. A context keeps its scratch
+// (match-finder tables, suffix arrays, rANS tables, ...) in an arena that
+// is recycled between calls, so once the arena and the caller's output
+// vector have grown to fit, a call makes no heap allocations. Contexts
+// are single-threaded; use one per thread. The output is an ordinary
+// archive that Compressor::decompress and crush decompress also read.
+class CompressionContext {
+public:
+    explicit CompressionContext(Algorithm algo = Algorithm::LZ77, int level = 5, size_t blockSize = 0);
+
+    // Replaces `out` with the archive for src[0 .. n).
+    void compress(const uint8_t* src, size_t n, std::vector<uint8_t>& out);
+
+private:
+    Algorithm algo;
+    int level;
+    size_t blockSize;
+    Arena arena;
+};
+
+class DecompressionContext {
+public:
+    // Replaces `out` with the data of the archive in src[0 .. n).
+    void decompress(const uint8_t* src, size_t n, std::vector<uint8_t>& out);
+
+private:
+    Arena arena;
 };
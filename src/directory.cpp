@@ -0,0 +1,107 @@
+#include "directory.hpp"
+#include "bitio.hpp"
+#include "xxhash.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+std::vector<DirEntry> collectEntries(const std::vector<std::string>& inputs, size_t& skipped) {
+    std::vector<DirEntry> entries;
+    skipped = 0;
+    for (const std::string& input : inputs) {
+        fs::path root = fs::absolute(input).lexically_normal();
+        if (!root.has_filename()) root = root.parent_path();
+        const std::string name = root.filename().generic_string();
+        if (name.empty()) throw std::runtime_error("Cannot archive " + input);
+
+        const fs::file_status st = fs::status(root);
+        if (fs::is_regular_file(st)) {
+            entries.push_back({name, uint64_t(fs::file_size(root)), false, root.string()});
+            continue;
+        }
+        if (!fs::is_directory(st)) throw std::runtime_error("Cannot open input file " + input);
+
+        const size_t first = entries.size();
+        entries.push_back({name, 0, true, root.string()});
+        for (const fs::directory_entry& de : fs::recursive_directory_iterator(root)) {
+            const std::string path = name + "/" + de.path().lexically_relative(root).generic_string();
+            const fs::file_status ls = de.symlink_status();
+            if (fs::is_directory(ls)) entries.push_back({path, 0, true, de.path().string()});
+            else if (fs::is_regular_file(ls)) entries.push_back({path, uint64_t(de.file_size()), false, de.path().string()});
+            else ++skipped;
+        }
+        std::sort(entries.begin() + first, entries.end(),
+                  [](const DirEntry& a, const DirEntry& b) { return a.path < b.path; });
+    }
+
+    std::vector<const std::string*> names;
+    names.reserve(entries.size());
+    for (const DirEntry& e : entries) names.push_back(&e.path);
+    std::sort(names.begin(), names.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+    for (size_t i = 1; i < names.size(); ++i) {
+        if (*names[i] == *names[i - 1]) throw std::runtime_error("Duplicate archive entry " + *names[i]);
+    }
+    return entries;
+}
+
+void writeDirectory(std::vector<uint8_t>& out, const std::vector<DirEntry>& entries) {
+    if (entries.size() > UINT32_MAX) throw std::runtime_error("Too many archive entries");
+    const size_t at = out.size();
+    out.insert(out.end(), kDirectoryHeaderSize, 0);
+    for (const DirEntry& e : entries) {
+        if (e.path.size() > UINT16_MAX) throw std::runtime_error("Path too long: " + e.path);
+        out.push_back(e.isDir ? 1 : 0);
+        putU32(out, uint32_t(e.size));
+        putU32(out, uint32_t(e.size >> 32));
+        putU16(out, uint16_t(e.path.size()));
+        out.insert(out.end(), e.path.begin(), e.path.end());
+    }
+    const size_t bytes = out.size() - at - kDirectoryHeaderSize;
+    if (bytes > UINT32_MAX) throw std::runtime_error("Archive directory too large");
+    storeU32(out.data() + at, uint32_t(entries.size()));
+    storeU32(out.data() + at + 4, uint32_t(bytes));
+    storeU32(out.data() + at + 8, xxh32(out.data() + at + kDirectoryHeaderSize, bytes));
+}
+
+size_t directoryBytes(const uint8_t* header) { return getU32(header + 4); }
+
+std::vector<DirEntry> parseDirectory(const uint8_t* src, size_t n) {
+    if (n < kDirectoryHeaderSize || directoryBytes(src) != n - kDirectoryHeaderSize)
+        throw std::runtime_error("Truncated archive");
+    const size_t count = getU32(src);
+    const uint8_t* p = src + kDirectoryHeaderSize;
+    const uint8_t* end = src + n;
+    if (xxh32(p, size_t(end - p)) != getU32(src + 8)) throw std::runtime_error("Corrupt archive directory");
+    if (count > size_t(end - p) / 11) throw std::runtime_error("Corrupt archive directory");
+
+    std::vector<DirEntry> entries(count);
+    for (DirEntry& e : entries) {
+        if (end - p < 11 || p[0] > 1) throw std::runtime_error("Corrupt archive directory");
+        e.isDir = p[0] == 1;
+        e.size = getU64(p + 1);
+        const size_t len = size_t(p[9]) | size_t(p[10]) << 8;
+        p += 11;
+        if (size_t(end - p) < len || (e.isDir && e.size)) throw std::runtime_error("Corrupt archive directory");
+        e.path.assign(reinterpret_cast<const char*>(p), len);
+        p += len;
+    }
+    if (p != end) throw std::runtime_error("Corrupt archive directory");
+    return entries;
+}
+
+bool safeEntryPath(const std::string& path) {
+    if (path.empty() || path[0] == '/') return false;
+#ifdef _WIN32
+    if (path.find_first_of("\\:") != std::string::npos) return false;
+#endif
+    size_t start = 0;
+    for (;;) {
+        size_t slash = path.find('/', start);
+        std::string part = path.substr(start, slash - start);
+        if (part.empty() || part == "." || part == "..") return false;
+        if (slash == std::string::npos) return true;
+        start = slash + 1;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ===== Archive directory =====
+// Central directory of a multi-file archive, stored right after the file
+// header: entryCount u32 | byteCount u32 | xxh32(entries) u32 | entries,
+// each kind u8 (0 file, 1 directory) | size u64 | pathLen u16 | path.
+// File contents are concatenated in directory order into the block
+// stream, so an entry's data starts where the previous file's ended.
+struct DirEntry {
+    std::string path;    // relative, '/'-separated
+    uint64_t size = 0;   // 0 for directories
+    bool isDir = false;
+    std::string source;  // where compress reads it from; empty when parsed
+};
+
+constexpr size_t kDirectoryHeaderSize = 4 + 4 + 4;
+
+// Entries for `inputs` (files and directory trees), each named after its
+// last path component. Trees are walked recursively and sorted by path,
+// so a directory precedes its contents; symlinks and special files are
+// skipped and counted in `skipped`.
+std::vector<DirEntry> collectEntries(const std::vector<std::string>& inputs, size_t& skipped);
+
+void writeDirectory(std::vector<uint8_t>& out, const std::vector<DirEntry>& entries);
+
+// Size of the entries that follow a directory header.
+size_t directoryBytes(const uint8_t* header);
+
+// Parses a whole directory section (header included) and checks it.
+std::vector<DirEntry> parseDirectory(const uint8_t* src, size_t n);
+
+// False for paths that could escape the output directory when unpacked.
+bool safeEntryPath(const std::string& path);
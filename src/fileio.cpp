@@ -0,0 +1,74 @@
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64  // 64-bit off_t for pread on 32-bit hosts
+#endif
+#include "fileio.hpp"
+#include <stdexcept>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef _WIN32
+RandomAccessFile::RandomAccessFile(const std::string& path) {
+    handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open input file");
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        throw std::runtime_error("Cannot open input file");
+    }
+    fileSize = uint64_t(size.QuadPart);
+}
+
+RandomAccessFile::~RandomAccessFile() { CloseHandle(handle); }
+
+void RandomAccessFile::read(uint64_t offset, uint8_t* dst, size_t n) const {
+    // OVERLAPPED carries the offset, so concurrent reads do not race on
+    // the handle's file pointer.
+    while (n > 0) {
+        DWORD chunk = n > (1u << 30) ? DWORD(1u << 30) : DWORD(n);
+        OVERLAPPED ov = {};
+        ov.Offset = DWORD(offset);
+        ov.OffsetHigh = DWORD(offset >> 32);
+        DWORD got = 0;
+        if (!ReadFile(handle, dst, chunk, &got, &ov) || got == 0)
+            throw std::runtime_error("Truncated archive");
+        dst += got;
+        offset += got;
+        n -= got;
+    }
+}
+#else
+RandomAccessFile::RandomAccessFile(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open input file");
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot open input file");
+    }
+    fileSize = uint64_t(st.st_size);
+}
+
+RandomAccessFile::~RandomAccessFile() { ::close(fd); }
+
+void RandomAccessFile::read(uint64_t offset, uint8_t* dst, size_t n) const {
+    while (n > 0) {
+        ssize_t got = ::pread(fd, dst, n, off_t(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) throw std::runtime_error("Failed reading input");
+        if (got == 0) throw std::runtime_error("Truncated archive");
+        dst += got;
+        offset += uint64_t(got);
+        n -= size_t(got);
+    }
+}
+#endif
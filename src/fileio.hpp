@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ===== Positioned file reads =====
+// Read-only file for random access: read() takes an absolute offset and
+// does not move a shared file position, so worker threads can fetch
+// different blocks of the same archive concurrently.
+class RandomAccessFile {
+public:
+    explicit RandomAccessFile(const std::string& path);
+    ~RandomAccessFile();
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    uint64_t size() const { return fileSize; }
+
+    // Reads exactly n bytes at `offset`; throws on a short read.
+    void read(uint64_t offset, uint8_t* dst, size_t n) const;
+
+private:
+#ifdef _WIN32
+    void* handle;
+#else
+    int fd;
+#endif
+    uint64_t fileSize = 0;
+};
@@ -0,0 +1,195 @@
+#include "huffman.hpp"
+#include "bitio.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// In-place minimum-redundancy lengths (Moffat & Katajainen). `a` holds the
+// weights in ascending order on entry and the matching code lengths on exit.
+static void minimumRedundancy(uint32_t* a, int n) {
+    a[0] += a[1];
+    int root = 0, leaf = 2;
+    for (int next = 1; next < n - 1; ++next) {
+        if (leaf >= n || a[root] < a[leaf]) { a[next] = a[root]; a[root++] = next; }
+        else a[next] = a[leaf++];
+        if (leaf >= n || (root < next && a[root] < a[leaf])) { a[next] += a[root]; a[root++] = next; }
+        else a[next] += a[leaf++];
+    }
+    a[n - 2] = 0;
+    for (int next = n - 3; next >= 0; --next) a[next] = a[a[next]] + 1;
+
+    int avail = 1, used = 0, depth = 0;
+    root = n - 2;
+    int next = n - 1;
+    while (avail > 0) {
+        while (root >= 0 && int(a[root]) == depth) { ++used; --root; }
+        while (avail > used) { a[next--] = depth; --avail; }
+        avail = 2 * used;
+        ++depth;
+        used = 0;
+    }
+}
+
+void huffmanCodeLengths(const uint32_t* freq, int numSymbols, uint8_t* lens, int maxLen) {
+    std::fill(lens, lens + numSymbols, 0);
+    int symbols[kHuffmanMaxSymbols];
+    int n = 0;
+    for (int s = 0; s < numSymbols; ++s)
+        if (freq[s]) symbols[n++] = s;
+    if (n == 0) return;
+    if (n == 1) { lens[symbols[0]] = 1; return; }
+
+    // Ties broken by symbol: the order stable_sort gives, without its
+    // temporary buffer
+    std::sort(symbols, symbols + n, [&](int a, int b) {
+        return freq[a] != freq[b] ? freq[a] < freq[b] : a < b;
+    });
+    uint32_t work[kHuffmanMaxSymbols];
+    for (int i = 0; i < n; ++i) work[i] = freq[symbols[i]];
+    minimumRedundancy(work, n);
+
+    // Clamp to maxLen, then lengthen the rarest symbols until the Kraft sum
+    // (in units of 2^-maxLen) fits again, then hand back any slack to the
+    // most frequent ones.
+    const uint32_t full = 1u << maxLen;
+    uint32_t kraft = 0;
+    for (int i = 0; i < n; ++i) {
+        lens[symbols[i]] = uint8_t(std::min<uint32_t>(work[i], maxLen));
+        kraft += full >> lens[symbols[i]];
+    }
+    while (kraft > full) {
+        for (int i = 0; i < n && kraft > full; ++i) {
+            uint8_t &len = lens[symbols[i]];
+            if (len < maxLen) { kraft -= full >> (len + 1); ++len; }
+        }
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        uint8_t &len = lens[symbols[i]];
+        while (len > 1 && kraft + (full >> len) <= full) { kraft += full >> len; --len; }
+    }
+}
+
+void huffmanCanonicalCodes(const uint8_t* lens, int numSymbols, uint32_t* codes) {
+    uint32_t count[16] = {0};
+    for (int s = 0; s < numSymbols; ++s) count[lens[s] & 15]++;
+    count[0] = 0;
+    uint32_t next[16] = {0};
+    uint32_t code = 0;
+    for (int len = 1; len <= kHuffmanMaxCodeLength; ++len) {
+        code = (code + count[len - 1]) << 1;
+        next[len] = code;
+    }
+    for (int s = 0; s < numSymbols; ++s)
+        codes[s] = lens[s] ? next[lens[s]]++ : 0;
+}
+
+bool HuffmanDecodeTable::build(const uint8_t* lens, int numSymbols) {
+    std::fill(std::begin(entries), std::end(entries), 0);
+    // Kraft sum first: an over-subscribed code would index past the table
+    uint32_t used = 0;
+    for (int s = 0; s < numSymbols; ++s) {
+        if (lens[s] > kHuffmanMaxCodeLength) return false;
+        if (lens[s]) used += 1u << (kHuffmanMaxCodeLength - lens[s]);
+    }
+    if (used > (1u << kHuffmanMaxCodeLength)) return false;
+    uint32_t codes[kHuffmanMaxSymbols];
+    huffmanCanonicalCodes(lens, numSymbols, codes);
+    for (int s = 0; s < numSymbols; ++s) {
+        int len = lens[s];
+        if (!len) continue;
+        uint32_t span = 1u << (kHuffmanMaxCodeLength - len);
+        uint32_t first = codes[s] << (kHuffmanMaxCodeLength - len);
+        std::fill(entries + first, entries + first + span, uint16_t(s << 4 | len));
+    }
+    return true;
+}
+
+void huffmanHistogram(const uint8_t* src, size_t n, uint32_t freq[256]) {
+    // Four interleaved tables break the store-to-load dependency on runs
+    // of the same byte.
+    uint32_t h[4][256] = {{0}};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        h[0][src[i]]++;
+        h[1][src[i + 1]]++;
+        h[2][src[i + 2]]++;
+        h[3][src[i + 3]]++;
+    }
+    for (; i < n; ++i) h[0][src[i]]++;
+    for (int s = 0; s < 256; ++s) freq[s] = h[0][s] + h[1][s] + h[2][s] + h[3][s];
+}
+
+void huffmanEncode(const uint8_t* src, size_t n, std::vector<uint8_t>& out) {
+    if (n == 0) return;
+    uint32_t freq[256];
+    huffmanHistogram(src, n, freq);
+
+    uint8_t lens[256];
+    uint32_t codes[256];
+    huffmanCodeLengths(freq, 256, lens);
+    huffmanCanonicalCodes(lens, 256, codes);
+
+    size_t totalBits = 0;
+    for (int s = 0; s < 256; ++s) totalBits += size_t(freq[s]) * lens[s];
+    size_t start = out.size();
+    out.resize(start + 128 + (totalBits + 7) / 8 + 8);
+    uint8_t* hdr = out.data() + start;
+    for (int s = 0; s < 256; s += 2) *hdr++ = uint8_t(lens[s] << 4 | lens[s + 1]);
+
+    // Flat code table: code bits in the high part, length in the low byte
+    uint32_t table[256];
+    for (int s = 0; s < 256; ++s) table[s] = codes[s] << 8 | lens[s];
+
+    BitWriter bw(hdr);
+    size_t i = 0;
+    // Four codes of at most 11 bits fit between flushes
+    for (; i + 4 <= n; i += 4) {
+        uint32_t a = table[src[i]], b = table[src[i + 1]];
+        uint32_t c = table[src[i + 2]], d = table[src[i + 3]];
+        bw.write(a >> 8, a & 0xff);
+        bw.write(b >> 8, b & 0xff);
+        bw.write(c >> 8, c & 0xff);
+        bw.write(d >> 8, d & 0xff);
+        bw.flush();
+    }
+    for (; i < n; ++i) {
+        uint32_t e = table[src[i]];
+        bw.write(e >> 8, e & 0xff);
+        bw.flush();
+    }
+    out.resize(start + 128 + bw.finish());
+}
+
+void huffmanDecode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize) {
+    if (rawSize == 0) {
+        if (n != 0) throw std::runtime_error("Corrupt Huffman block");
+        return;
+    }
+    if (n < 128) throw std::runtime_error("Corrupt Huffman block");
+    uint8_t lens[256];
+    for (int i = 0; i < 128; ++i) { lens[2 * i] = src[i] >> 4; lens[2 * i + 1] = src[i] & 15; }
+    HuffmanDecodeTable table;
+    if (!table.build(lens, 256)) throw std::runtime_error("Corrupt Huffman block");
+
+    BitReader br(src + 128, n - 128);
+    const uint16_t* entries = table.entries;
+    uint8_t* out = dst;
+    uint8_t* const end = dst + rawSize;
+    bool hole = false;
+
+    // One refill always covers four maximum-length codes
+    auto decodeOne = [&]() {
+        uint16_t e = entries[br.peek(kHuffmanMaxCodeLength)];
+        hole |= (e & 15) == 0;
+        br.consume(e & 15);
+        *out++ = uint8_t(e >> 4);
+    };
+    while (end - out >= 4) {
+        br.refill();
+        decodeOne(); decodeOne(); decodeOne(); decodeOne();
+    }
+    while (out < end) {
+        br.refill();
+        decodeOne();
+    }
+    if (hole || br.overrun()) throw std::runtime_error("Corrupt Huffman block");
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===== Canonical Huffman =====
+// Code lengths are capped so a single table lookup resolves any code.
+constexpr int kHuffmanMaxCodeLength = 11;
+// Largest alphabet the table helpers accept (bytes plus run/length codes).
+constexpr int kHuffmanMaxSymbols = 512;
+
+// Byte histogram of src.
+void huffmanHistogram(const uint8_t* src, size_t n, uint32_t freq[256]);
+
+// Length-limited code lengths (0 = unused symbol) for a histogram over
+// numSymbols symbols.
+void huffmanCodeLengths(const uint32_t* freq, int numSymbols, uint8_t* lens,
+                        int maxLen = kHuffmanMaxCodeLength);
+
+// Canonical codes (MSB-first) for the given lengths.
+void huffmanCanonicalCodes(const uint8_t* lens, int numSymbols, uint32_t* codes);
+
+// Flat decode table: entry = (symbol << 4) | code length, indexed by the
+// next kHuffmanMaxCodeLength bits of the stream. Length 0 marks a hole.
+struct HuffmanDecodeTable {
+    uint16_t entries[1u << kHuffmanMaxCodeLength];
+
+    // Returns false if the lengths do not describe a valid prefix code.
+    bool build(const uint8_t* lens, int numSymbols);
+};
+
+// Block format: 128 bytes of 4-bit code lengths followed by the bitstream.
+void huffmanEncode(const uint8_t* src, size_t n, std::vector<uint8_t>& out);
+void huffmanDecode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize);
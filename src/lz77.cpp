@@ -0,0 +1,420 @@
+#include "lz77.hpp"
+#include "bitio.hpp"
+#include "huffman.hpp"
+#include "rans.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static uint32_t load32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+static uint64_t load64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+
+// Index of the first differing byte in a nonzero a ^ b of two load64s: the
+// lowest set byte on little-endian hosts, the highest on big-endian ones.
+static unsigned firstDiffByte(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, x);
+    return unsigned(idx) / 8;
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return unsigned(__builtin_clzll(x)) / 8;
+#else
+    return unsigned(__builtin_ctzll(x)) / 8;
+#endif
+}
+
+static unsigned highBit(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse(&idx, x);
+    return unsigned(idx);
+#else
+    return 31u - unsigned(__builtin_clz(x));
+#endif
+}
+
+// Worth of a match in rough bit units: a longer one only wins if it is not
+// so much farther back that its offset costs more than the extra bytes save.
+static int matchGain(size_t length, uint32_t offset) { return int(3 * length) - int(highBit(offset)); }
+
+// Far offsets are 3 bytes and rarely repeat, so they code poorly; such a
+// match must be 6 long at 32 KiB, growing to 10 at 4 MiB and beyond.
+static size_t minFarLength(uint32_t offset) { return 6 + (highBit(offset) - 15) * 2 / 3; }
+
+// Length of the common prefix of a and b, comparing 8 bytes at a time.
+static size_t commonLength(const uint8_t* a, const uint8_t* b, const uint8_t* bEnd) {
+    const uint8_t* start = b;
+    while (bEnd - b >= 8) {
+        uint64_t diff = load64(a) ^ load64(b);
+        if (diff) return size_t(b - start) + firstDiffByte(diff);
+        a += 8;
+        b += 8;
+    }
+    while (b < bEnd && *a == *b) { ++a; ++b; }
+    return size_t(b - start);
+}
+
+LZ77Params lz77Params(int level) {
+    static const LZ77Params kLevels[9] = {
+        // window hash depth nice  max    lazy   skip insert
+        {16,    14,  1,    16,   64,    false, 6,    1},
+        {17,    15,  2,    24,   128,   false, 7,    16},
+        {18,    16,  4,    32,   256,   false, 8,    32},
+        {19,    16,  8,    64,   512,   false, 0,    0},
+        {20,    17,  16,   96,   1024,  true,  0,    0},
+        {20,    17,  32,   128,  2048,  true,  0,    0},
+        {21,    18,  64,   256,  4096,  true,  0,    0},
+        {22,    19,  128,  512,  8192,  true,  0,    0},
+        {23,    20,  256,  1024, 16384, true,  0,    0},
+    };
+    return kLevels[std::clamp(level, 1, 9) - 1];
+}
+
+MatchFinder::MatchFinder(const uint8_t* data, size_t size, const LZ77Params& params, Arena& arena)
+    : data(data), size(size), params(params) {
+    // No point keeping more history or hash buckets than the block holds;
+    // this also keeps small inputs from clearing megabyte-sized tables.
+    size_t window = size_t(1) << this->params.windowLog;
+    while (window > 1024 && window / 2 >= size) window /= 2;
+    while (this->params.hashLog > 10 && (size_t(1) << (this->params.hashLog - 1)) >= size) --this->params.hashLog;
+    windowMask = window - 1;
+    farOffset = window > (size_t(1) << 16) ? kFarOffset : window;
+    head = arena.allocZeroed<uint32_t>(size_t(1) << this->params.hashLog);
+    chain = arena.alloc<uint32_t>(window);
+}
+
+uint32_t MatchFinder::hash(size_t pos) const {
+    return (load32(data + pos) * 2654435761u) >> (32 - params.hashLog);
+}
+
+void MatchFinder::insert(size_t pos) {
+    if (pos + kMinMatch > size) return;
+    uint32_t &h = head[hash(pos)];
+    chain[pos & windowMask] = h;
+    h = uint32_t(pos + 1);
+}
+
+size_t MatchFinder::find(size_t pos, uint32_t& offset) const {
+    if (pos + kMinMatch > size) return 0;
+    return search(pos, head[hash(pos)], offset);
+}
+
+size_t MatchFinder::findAndInsert(size_t pos, uint32_t& offset) {
+    if (pos + kMinMatch > size) return 0;
+    uint32_t &h = head[hash(pos)];
+    const uint32_t cand = h;
+    chain[pos & windowMask] = cand;
+    h = uint32_t(pos + 1);
+    // With a single probe most positions are settled by one 4-byte compare
+    if (params.chainDepth == 1 && (!cand || load32(data + cand - 1) != load32(data + pos))) {
+        probeCount += cand != 0;
+        return 0;
+    }
+    return search(pos, cand, offset);
+}
+
+size_t MatchFinder::search(size_t pos, uint32_t cand, uint32_t& offset) const {
+    const uint8_t* cur = data + pos;
+    const uint8_t* end = data + std::min(size, pos + params.maxMatch);
+    size_t best = kMinMatch - 1;
+    int bestGain = 0;
+    unsigned depth = params.chainDepth;
+    for (; cand && depth; --depth) {
+        size_t c = cand - 1;
+        if (pos - c > windowMask) break;
+        // Cheap reject: a longer match must agree on the byte just past best
+        if (data[c + best] == cur[best]) {
+            size_t len = commonLength(data + c, cur, end);
+            const uint32_t dist = uint32_t(pos - c);
+            if (len > best && (dist < farOffset || len >= minFarLength(dist)) &&
+                (best < kMinMatch || matchGain(len, dist) > bestGain)) {
+                best = len;
+                bestGain = matchGain(len, dist);
+                offset = dist;
+                if (len >= params.niceLength || cur + len == end) break;
+            }
+        }
+        cand = chain[c & windowMask];
+    }
+    // A break leaves cand and depth set without counting that candidate
+    probeCount += params.chainDepth - depth + (cand && depth ? 1 : 0);
+    return best >= kMinMatch ? best : 0;
+}
+
+size_t lz77Compress(const uint8_t* src, size_t n, int level, LZ77Sequence* seqs, Arena& arena) {
+    LZ77Params params = lz77Params(level);
+    MatchFinder mf(src, n, params, arena);
+    size_t count = 0;
+    size_t pos = 0, anchor = 0, misses = 0;
+    while (pos + MatchFinder::kMinMatch <= n) {
+        uint32_t offset = 0;
+        size_t len = mf.findAndInsert(pos, offset);
+        if (!len) {
+            // Incompressible stretches are crossed in ever larger steps
+            pos += params.skipLog ? 1 + (misses++ >> params.skipLog) : 1;
+            continue;
+        }
+        misses = 0;
+        if (params.lazy && len < params.niceLength) {
+            // Defer to pos + 1 when it starts a better match; the current
+            // one gets a byte's credit for not emitting a literal first
+            uint32_t nextOffset = 0;
+            size_t next = mf.find(pos + 1, nextOffset);
+            if (next > len && matchGain(next, nextOffset) > matchGain(len, offset) + 3) { ++pos; continue; }
+        }
+        seqs[count++] = {uint32_t(pos - anchor), uint32_t(len), offset};
+        // The fast levels index only the start of a long match and its last
+        // two positions, which the next match is most likely to reuse
+        if (params.maxInsert && len > params.maxInsert) {
+            for (size_t p = pos + 1; p < pos + params.maxInsert; ++p) mf.insert(p);
+            for (size_t p = std::max(pos + params.maxInsert, pos + len - 2); p < pos + len; ++p) mf.insert(p);
+        } else {
+            for (size_t p = pos + 1; p < pos + len; ++p) mf.insert(p);
+        }
+        pos += len;
+        anchor = pos;
+    }
+    seqs[count++] = {uint32_t(n - anchor), 0, 0};
+    Stats::count(Counter::Sequences, count);
+    Stats::count(Counter::MatchProbes, mf.probes());
+    return count;
+}
+
+// ===== Block format =====
+static const uint32_t kNibbleEscape = 15;
+static const size_t kStreamHeaderSize = 1 + 4 + 4;
+static const size_t kWildCopy = 16;  // slack the fast copy loops may overrun
+// Offset coding: 2 or 3 fixed bytes, or kVariableOffsets for 15 bits in two
+// bytes with the top bit of the second set when a third byte follows.
+static const uint8_t kVariableOffsets = 1;
+static const uint32_t kShortOffset = 1u << 15;
+
+static uint8_t* putVarint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) { *p++ = uint8_t(v | 0x80); v >>= 7; }
+    *p++ = uint8_t(v);
+    return p;
+}
+
+static uint8_t* putOffset(uint8_t* p, uint32_t offset, uint8_t coding) {
+    if (coding == 2 || offset < kShortOffset) {
+        storeU16(p, offset);
+        return p + 2;
+    }
+    storeU16(p, (offset & (kShortOffset - 1)) | kShortOffset);
+    p[2] = uint8_t(offset >> 15);
+    return p + 3;
+}
+
+// Appends one stream, entropy coded when that makes it smaller: from
+// level 4 with Huffman, from level 5 also with rANS, whichever wins.
+static void putStream(std::vector<uint8_t>& out, const uint8_t* data, size_t size, int level, Arena& arena) {
+    const size_t at = out.size();
+    const size_t body = at + kStreamHeaderSize;
+    out.push_back(0);
+    putU32(out, uint32_t(size));
+    putU32(out, uint32_t(size));
+    if (level < 4 || size < 64) {
+        out.insert(out.end(), data, data + size);
+        return;
+    }
+    uint8_t mode = 0;
+    size_t best = size;
+    huffmanEncode(data, size, out);
+    size_t coded = out.size() - body;
+    if (coded + coded / 32 < size) { mode = 1; best = coded; }
+    else out.resize(body);
+    if (level >= 5) {
+        const size_t from = out.size();
+        ransEncode(data, size, 0, out, arena);
+        coded = out.size() - from;
+        if (mode ? coded < best : coded + coded / 32 < size) {
+            std::memmove(&out[body], &out[from], coded);
+            mode = 2;
+            best = coded;
+        }
+        out.resize(body + (mode ? best : 0));
+    }
+    if (!mode) {
+        out.insert(out.end(), data, data + size);
+        return;
+    }
+    out[at] = mode;
+    storeU32(&out[at + 5], uint32_t(best));
+}
+
+void lz77Encode(const uint8_t* src, size_t n, int level, std::vector<uint8_t>& out, Arena& arena) {
+    Arena::Scope scope(arena);
+    LZ77Sequence* seqs = arena.alloc<LZ77Sequence>(n / MatchFinder::kMinMatch + 1);
+    const size_t count = lz77Compress(src, n, level, seqs, arena);
+    uint32_t maxOffset = 0;
+    for (size_t i = 0; i < count; ++i) maxOffset = std::max(maxOffset, seqs[i].offset);
+    // Fixed 16-bit offsets while they all fit, so a 64 KiB window keeps
+    // 32-64 KiB offsets at two bytes; otherwise only far ones take three.
+    const uint8_t offsetCoding = maxOffset < (1u << 16) ? 2 : kVariableOffsets;
+
+    // Worst cases: two 5-byte varints and a 3-byte offset per sequence
+    uint8_t* tokens = arena.alloc<uint8_t>(count);
+    uint8_t* lengths = arena.alloc<uint8_t>(count * 10);
+    uint8_t* offsets = arena.alloc<uint8_t>(count * 3);
+    uint8_t* literals = arena.alloc<uint8_t>(n);
+    uint8_t *lenEnd = lengths, *offEnd = offsets, *litEnd = literals;
+    size_t pos = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const LZ77Sequence& s = seqs[i];
+        uint32_t lit = std::min(s.literals, kNibbleEscape);
+        uint32_t match = s.length ? std::min(s.length - 4, kNibbleEscape) : 0;
+        tokens[i] = uint8_t(lit << 4 | match);
+        if (lit == kNibbleEscape) lenEnd = putVarint(lenEnd, s.literals - kNibbleEscape);
+        if (s.length && match == kNibbleEscape) lenEnd = putVarint(lenEnd, s.length - 4 - kNibbleEscape);
+        std::memcpy(litEnd, src + pos, s.literals);
+        litEnd += s.literals;
+        if (s.length) offEnd = putOffset(offEnd, s.offset, offsetCoding);
+        pos += s.literals + s.length;
+    }
+
+    putU32(out, uint32_t(count));
+    out.push_back(offsetCoding);
+    putStream(out, tokens, count, level, arena);
+    putStream(out, lengths, size_t(lenEnd - lengths), level, arena);
+    putStream(out, offsets, size_t(offEnd - offsets), level, arena);
+    putStream(out, literals, size_t(litEnd - literals), level, arena);
+}
+
+// A stream view; entropy-coded streams are decoded into arena scratch with
+// kWildCopy bytes of padding so literal copies can overrun.
+struct StreamView {
+    const uint8_t* data;
+    size_t size;
+    bool padded;
+};
+
+static StreamView getStream(const uint8_t*& p, const uint8_t* end, size_t limit, Arena& arena) {
+    if (size_t(end - p) < kStreamHeaderSize) throw std::runtime_error("Corrupt LZ77 block");
+    uint8_t mode = p[0];
+    uint32_t rawLen = getU32(p + 1), storedLen = getU32(p + 5);
+    p += kStreamHeaderSize;
+    if (mode > 2 || rawLen > limit || size_t(end - p) < storedLen || (mode == 0 && storedLen != rawLen))
+        throw std::runtime_error("Corrupt LZ77 block");
+    StreamView v{p, rawLen, false};
+    if (mode == 1) {
+        uint8_t* scratch = arena.alloc<uint8_t>(rawLen + kWildCopy);
+        huffmanDecode(p, storedLen, scratch, rawLen);
+        v = {scratch, rawLen, true};
+    } else if (mode == 2) {
+        uint8_t* scratch = arena.alloc<uint8_t>(rawLen + kWildCopy);
+        ransDecode(p, storedLen, scratch, rawLen, arena);
+        v = {scratch, rawLen, true};
+    }
+    p += storedLen;
+    return v;
+}
+
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) return false;
+        uint8_t b = *p++;
+        v |= uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline void copy8(uint8_t* dst, const uint8_t* src) { std::memcpy(dst, src, 8); }
+static inline void copy16(uint8_t* dst, const uint8_t* src) { std::memcpy(dst, src, 16); }
+
+void lz77Decode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Arena& arena) {
+    const uint8_t* p = src;
+    const uint8_t* end = src + n;
+    if (n < 5) throw std::runtime_error("Corrupt LZ77 block");
+    const uint32_t count = getU32(p);
+    const uint8_t offsetCoding = p[4];
+    p += 5;
+    if (count == 0 || count > rawSize / MatchFinder::kMinMatch + 1 || offsetCoding < kVariableOffsets || offsetCoding > 3)
+        throw std::runtime_error("Corrupt LZ77 block");
+
+    Arena::Scope scope(arena);
+    const size_t limit = 2 * rawSize + 64;
+    StreamView tokens = getStream(p, end, limit, arena);
+    StreamView lengths = getStream(p, end, limit, arena);
+    StreamView offsets = getStream(p, end, limit, arena);
+    StreamView literals = getStream(p, end, limit, arena);
+    if (p != end || tokens.size != count) throw std::runtime_error("Corrupt LZ77 block");
+    const uint8_t* lenPtr = lengths.data;
+    const uint8_t* lenEnd = lengths.data + lengths.size;
+    const uint8_t* offPtr = offsets.data;
+    const uint8_t* offEnd = offsets.data + offsets.size;
+    const uint8_t* litPtr = literals.data;
+    const uint8_t* litEnd = literals.data + literals.size;
+    // Literals decoded into scratch carry padding; raw ones do not
+    const uint8_t* litLimit = literals.padded ? litEnd + kWildCopy : litEnd;
+
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + rawSize;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t token = tokens.data[i];
+        size_t lit = token >> 4;
+        if (lit == kNibbleEscape) {
+            uint32_t extra;
+            if (!getVarint(lenPtr, lenEnd, extra)) throw std::runtime_error("Corrupt LZ77 block");
+            lit += extra;
+        }
+        if (lit > size_t(litEnd - litPtr) || lit > size_t(oend - op)) throw std::runtime_error("Corrupt LZ77 block");
+        if (lit <= kWildCopy && size_t(litLimit - litPtr) >= kWildCopy && size_t(oend - op) >= kWildCopy)
+            copy16(op, litPtr);
+        else std::memcpy(op, litPtr, lit);
+        op += lit;
+        litPtr += lit;
+
+        if (i + 1 == count) {
+            if (token & 15) throw std::runtime_error("Corrupt LZ77 block");
+            break;
+        }
+        size_t len = (token & 15) + MatchFinder::kMinMatch;
+        if ((token & 15) == kNibbleEscape) {
+            uint32_t extra;
+            if (!getVarint(lenPtr, lenEnd, extra)) throw std::runtime_error("Corrupt LZ77 block");
+            len += extra;
+        }
+        if (offEnd - offPtr < 2) throw std::runtime_error("Corrupt LZ77 block");
+        size_t offset = getU16(offPtr);
+        offPtr += 2;
+        if (offsetCoding == 3 || (offsetCoding == kVariableOffsets && offset >= kShortOffset)) {
+            if (offPtr == offEnd) throw std::runtime_error("Corrupt LZ77 block");
+            offset = offsetCoding == 3 ? offset | size_t(*offPtr) << 16 : (offset - kShortOffset) | size_t(*offPtr) << 15;
+            ++offPtr;
+        }
+        if (offset == 0 || offset > size_t(op - dst) || len > size_t(oend - op))
+            throw std::runtime_error("Corrupt LZ77 block");
+
+        // Wild copies may run up to 15 bytes past the match, but never past
+        // this block's output. Each chunk reads from at least its own size
+        // back, so it only sees bytes that are already final.
+        const uint8_t* match = op - offset;
+        uint8_t* target = op + len;
+        if (offset == 1) {
+            std::memset(op, *match, len);
+        } else if (size_t(oend - target) < kWildCopy) {
+            for (uint8_t* q = op; q < target; ++q) *q = *match++;
+        } else if (offset >= 16) {
+            copy16(op, match);
+            for (size_t k = 16; k < len; k += 16) copy16(op + k, match + k);
+        } else if (offset >= 8) {
+            copy8(op, match);
+            for (size_t k = 8; k < len; k += 8) copy8(op + k, match + k);
+        } else {
+            // Short period: lay down 16 bytes of the pattern, then copy
+            // 8 bytes at a time from a whole number of periods >= 8 back.
+            for (size_t k = 0; k < 16; ++k) op[k] = match[k];
+            const size_t period = offset * ((8 + offset - 1) / offset);
+            for (size_t k = 16; k < len; k += 8) copy8(op + k, op + k - period);
+        }
+        op = target;
+    }
+    if (op != oend || lenPtr != lenEnd || offPtr != offEnd || litPtr != litEnd)
+        throw std::runtime_error("Corrupt LZ77 block");
+}
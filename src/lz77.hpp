@@ -0,0 +1,83 @@
+#pragma once
+#include "arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===== LZ77 =====
+// One parsed step: `literals` raw bytes, then `length` bytes copied from
+// `offset` back. The last sequence of a block has no match (length 0).
+struct LZ77Sequence {
+    uint32_t literals;
+    uint32_t length;
+    uint32_t offset;
+};
+
+// Match-finder tuning per compression level.
+struct LZ77Params {
+    unsigned windowLog;    // history searched, 64 KiB .. 8 MiB
+    unsigned hashLog;      // hash-head table size
+    unsigned chainDepth;   // candidates probed per position
+    unsigned niceLength;   // stop probing once a match this long is found
+    unsigned maxMatch;     // longest match emitted
+    bool lazy;             // defer a match if the next position has a longer one
+    unsigned skipLog;      // after 2^skipLog misses in a row, step ahead 2, 3, ... bytes (0 = off)
+    unsigned maxInsert;    // longer matches index only this many leading positions and the last two (0 = all)
+};
+
+LZ77Params lz77Params(int level);
+
+// Hash-head/chain match finder over 4-byte prefixes. Positions must be
+// inserted in increasing order; chain links older than the window are
+// treated as dead.
+class MatchFinder {
+public:
+    // Tables come from `arena` and live as long as its current scope.
+    MatchFinder(const uint8_t* data, size_t size, const LZ77Params& params, Arena& arena);
+
+    void insert(size_t pos);
+    // Longest match for pos among inserted positions (0 if none >= kMinMatch).
+    size_t find(size_t pos, uint32_t& offset) const;
+    // find() then insert(pos), hashing pos once.
+    size_t findAndInsert(size_t pos, uint32_t& offset);
+
+    static constexpr size_t kMinMatch = 4;
+    // Offsets from here on take a third byte once the window is wider than
+    // 64 KiB (see lz77Encode), so find() wants longer matches there.
+    static constexpr size_t kFarOffset = size_t(1) << 15;
+
+    // Chain candidates examined by find() so far.
+    uint64_t probes() const { return probeCount; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    LZ77Params params;
+    size_t windowMask;
+    size_t farOffset;  // kFarOffset, or past the window when offsets stay 2 bytes
+    uint32_t* head;   // hash -> pos + 1 (0 = empty)
+    uint32_t* chain;  // pos & windowMask -> previous pos + 1
+    mutable uint64_t probeCount = 0;
+
+    uint32_t hash(size_t pos) const;
+    size_t search(size_t pos, uint32_t cand, uint32_t& offset) const;
+};
+
+// Parses src into `seqs` (room for n / kMinMatch + 1) and returns the count.
+size_t lz77Compress(const uint8_t* src, size_t n, int level, LZ77Sequence* seqs, Arena& arena);
+
+// Block format: sequence count u32 | offset coding u8 | four streams, each
+// mode u8 (0 raw, 1 Huffman, 2 rANS) | rawLen u32 | storedLen u32 | data:
+//   tokens:   one byte per sequence, literal length << 4 | (match length - 4),
+//             a nibble of 15 meaning the rest follows in `lengths`
+//   lengths:  LEB128 varints for the long literal/match lengths
+//   offsets:  little-endian match offsets, all 2 bytes (coding 2) or, for
+//             blocks with farther matches (coding 1), 2 bytes below 32 KiB
+//             and 3 bytes with the top bit of the second byte set beyond;
+//             coding 3 (all 3 bytes) is still read
+//   literals: the literal bytes
+// From level 4 a stream is Huffman coded when that makes it smaller, and
+// from level 5 order-0 rANS is tried as well. The u32 fields are
+// little-endian.
+void lz77Encode(const uint8_t* src, size_t n, int level, std::vector<uint8_t>& out, Arena& arena);
+void lz77Decode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Arena& arena);
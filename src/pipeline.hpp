@@ -0,0 +1,98 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bounded read -> process -> write pipeline over a ring of `depth` reusable
+// slots. read(slot) runs on its own thread and returns false at end of
+// input, process(slot) runs on `threads` workers, and write(slot) runs on
+// the calling thread in input order. Memory stays at depth x slot size no
+// matter how long the input is, and I/O overlaps with the work in between.
+// The first exception from any stage stops the pipeline and is rethrown.
+template <typename Slot, typename Read, typename Process, typename Write>
+void runPipeline(int threads, size_t depth, Read&& read, Process&& process, Write&& write) {
+    enum class State { Free, Filled, Busy, Done };
+    if (threads < 1) threads = 1;
+    if (depth < 2) depth = 2;
+
+    std::vector<Slot> slots(depth);
+    std::vector<State> state(depth, State::Free);
+    std::mutex m;
+    std::condition_variable cv;
+    size_t filled = 0;      // slots handed over by the reader
+    size_t taken = 0;       // slots claimed by workers
+    bool readDone = false;
+    bool abort = false;
+    std::exception_ptr error;
+
+    auto fail = [&]() {
+        std::lock_guard<std::mutex> lock(m);
+        if (!error) error = std::current_exception();
+        abort = true;
+        cv.notify_all();
+    };
+
+    std::thread reader([&]() {
+        try {
+            for (size_t seq = 0;; ++seq) {
+                Slot &slot = slots[seq % depth];
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&] { return abort || state[seq % depth] == State::Free; });
+                    if (abort) return;
+                }
+                bool more = read(slot);
+                std::lock_guard<std::mutex> lock(m);
+                if (more) { state[seq % depth] = State::Filled; ++filled; }
+                else readDone = true;
+                cv.notify_all();
+                if (!more) return;
+            }
+        } catch (...) { fail(); }
+    });
+
+    auto worker = [&]() {
+        try {
+            for (;;) {
+                size_t seq;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&] { return abort || taken < filled || readDone; });
+                    if (abort || taken == filled) return;
+                    seq = taken++;
+                    state[seq % depth] = State::Busy;
+                }
+                process(slots[seq % depth]);
+                std::lock_guard<std::mutex> lock(m);
+                state[seq % depth] = State::Done;
+                cv.notify_all();
+            }
+        } catch (...) { fail(); }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (int t = 0; t < threads; ++t) workers.emplace_back(worker);
+
+    try {
+        for (size_t seq = 0;; ++seq) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] {
+                    return abort || state[seq % depth] == State::Done || (readDone && seq == filled);
+                });
+                if (abort || state[seq % depth] != State::Done) break;
+            }
+            write(slots[seq % depth]);
+            std::lock_guard<std::mutex> lock(m);
+            state[seq % depth] = State::Free;
+            cv.notify_all();
+        }
+    } catch (...) { fail(); }
+
+    reader.join();
+    for (auto &w : workers) w.join();
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,246 @@
+#include "rans.hpp"
+#include "bitio.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+static const uint32_t kScaleBits = 12;
+static const uint32_t kScale = 1u << kScaleBits;
+static const uint32_t kMask = kScale - 1;
+static const uint32_t kRansL = 1u << 16;  // lower bound of the state interval
+
+// Scales counts to sum to kScale, keeping every present symbol >= 1.
+static void normalizeFreqs(const uint32_t* counts, uint32_t* freq) {
+    uint64_t total = 0;
+    for (int s = 0; s < 256; ++s) total += counts[s];
+    std::fill(freq, freq + 256, 0);
+    if (total == 0) return;
+
+    int64_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (!counts[s]) continue;
+        freq[s] = std::max<uint32_t>(1, uint32_t(uint64_t(counts[s]) * kScale / total));
+        sum += freq[s];
+    }
+    // Hand the rounding error to (or take it from) the most frequent symbols
+    while (sum != kScale) {
+        int top = int(std::max_element(freq, freq + 256) - freq);
+        if (sum < kScale) { freq[top] += uint32_t(kScale - sum); sum = kScale; }
+        else {
+            uint32_t take = uint32_t(std::min<int64_t>(sum - kScale, freq[top] - 1));
+            freq[top] -= take;
+            sum -= take;
+        }
+    }
+}
+
+// Table: 32-byte presence bitmap, then each present frequency as 1 byte
+// (< 128) or 2 bytes (high bit set).
+static void writeFreqs(const uint32_t* freq, std::vector<uint8_t>& out) {
+    uint8_t bitmap[32] = {0};
+    for (int s = 0; s < 256; ++s)
+        if (freq[s]) bitmap[s >> 3] |= uint8_t(1 << (s & 7));
+    out.insert(out.end(), bitmap, bitmap + 32);
+    for (int s = 0; s < 256; ++s) {
+        if (!freq[s]) continue;
+        if (freq[s] < 128) out.push_back(uint8_t(freq[s]));
+        else { out.push_back(uint8_t(0x80 | (freq[s] >> 8))); out.push_back(uint8_t(freq[s])); }
+    }
+}
+
+static bool readFreqs(const uint8_t*& p, const uint8_t* end, uint32_t* freq) {
+    if (end - p < 32) return false;
+    const uint8_t* bitmap = p;
+    p += 32;
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        freq[s] = 0;
+        if (!(bitmap[s >> 3] & (1 << (s & 7)))) continue;
+        if (p >= end) return false;
+        uint32_t f = *p++;
+        if (f & 0x80) {
+            if (p >= end) return false;
+            f = (f & 0x7f) << 8 | *p++;
+        }
+        if (f == 0) return false;
+        freq[s] = f;
+        sum += f;
+    }
+    return sum == kScale;
+}
+
+// Decode entry: symbol | (slot - start) << 8 | (freq - 1) << 20
+static void buildDecodeTable(const uint32_t* freq, uint32_t* table) {
+    uint32_t start = 0;
+    for (uint32_t s = 0; s < 256; ++s) {
+        for (uint32_t k = 0; k < freq[s]; ++k)
+            table[start + k] = s | k << 8 | (freq[s] - 1) << 20;
+        start += freq[s];
+    }
+}
+
+// Lane k owns [k * seg, (k + 1) * seg); the last lane also takes the tail.
+static size_t segmentLength(size_t n) { return n / kRansLanes; }
+
+int ransOrderForLevel(int level, size_t blockSize) {
+    // Order-1 tables cost up to ~100 KB of header, so only for big blocks
+    return (level >= 7 && blockSize >= (256u << 10)) ? 1 : 0;
+}
+
+void ransEncode(const uint8_t* src, size_t n, int order, std::vector<uint8_t>& out, Arena& arena) {
+    if (n == 0) return;
+    Arena::Scope scope(arena);
+    const size_t seg = segmentLength(n);
+    const int contexts = order ? 256 : 1;
+    auto contextAt = [&](size_t pos) -> int {
+        if (!order) return 0;
+        size_t lane = std::min<size_t>(seg ? pos / seg : kRansLanes - 1, kRansLanes - 1);
+        return pos == lane * seg ? 0 : src[pos - 1];
+    };
+
+    uint32_t* counts = arena.allocZeroed<uint32_t>(size_t(contexts) * 256);
+    for (size_t i = 0; i < n; ++i) counts[size_t(contextAt(i)) * 256 + src[i]]++;
+
+    uint32_t* freq = arena.alloc<uint32_t>(size_t(contexts) * 256);
+    uint32_t* start = arena.alloc<uint32_t>(size_t(contexts) * 256);
+    out.push_back(uint8_t(order));
+    if (order) {
+        uint8_t bitmap[32] = {0};
+        for (int c = 0; c < 256; ++c)
+            for (int s = 0; s < 256; ++s)
+                if (counts[size_t(c) * 256 + s]) { bitmap[c >> 3] |= uint8_t(1 << (c & 7)); break; }
+        out.insert(out.end(), bitmap, bitmap + 32);
+    }
+    for (int c = 0; c < contexts; ++c) {
+        uint32_t* f = &freq[size_t(c) * 256];
+        normalizeFreqs(&counts[size_t(c) * 256], f);
+        if (f[std::max_element(f, f + 256) - f] == 0) continue;
+        writeFreqs(f, out);
+        uint32_t* st = &start[size_t(c) * 256];
+        uint32_t acc = 0;
+        for (int s = 0; s < 256; ++s) { st[s] = acc; acc += f[s]; }
+    }
+
+    // Encode back to front into a scratch buffer; every symbol emits at
+    // most one 16-bit word.
+    uint16_t* words = arena.alloc<uint16_t>(n + 1);
+    uint16_t* const wordsEnd = words + n + 1;
+    uint16_t* ptr = wordsEnd;
+    uint32_t state[kRansLanes];
+    std::fill(state, state + kRansLanes, kRansL);
+
+    auto put = [&](uint32_t& x, size_t pos) {
+        size_t idx = size_t(contextAt(pos)) * 256 + src[pos];
+        uint32_t f = freq[idx];
+        if (x >= (uint64_t(f) << (32 - kScaleBits))) { *--ptr = uint16_t(x); x >>= 16; }
+        x = ((x / f) << kScaleBits) + (x % f) + start[idx];
+    };
+    for (size_t pos = n; pos-- > kRansLanes * seg;) put(state[kRansLanes - 1], pos);
+    for (size_t r = seg; r-- > 0;)
+        for (int k = kRansLanes; k-- > 0;) put(state[k], size_t(k) * seg + r);
+
+    size_t at = out.size();
+    size_t wordCount = size_t(wordsEnd - ptr);
+    out.resize(at + 4 * kRansLanes + 2 * wordCount);
+    uint8_t* q = out.data() + at;
+    for (uint32_t x : state) { storeU32(q, x); q += 4; }
+    for (; ptr != wordsEnd; ++ptr, q += 2) storeU16(q, *ptr);
+}
+
+void ransDecode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Arena& arena) {
+    if (rawSize == 0) {
+        if (n != 0) throw std::runtime_error("Corrupt rANS block");
+        return;
+    }
+    const uint8_t* p = src;
+    const uint8_t* end = src + n;
+    if (n < 1 || *p > 1) throw std::runtime_error("Corrupt rANS block");
+    const int order = *p++;
+
+    // ctxTable[c] -> index into tables, or -1 for a context never seen
+    int ctxTable[256];
+    std::fill(ctxTable, ctxTable + 256, 0);
+    Arena::Scope scope(arena);
+    uint32_t* tables;
+    uint32_t freq[256];
+    if (order) {
+        if (end - p < 32) throw std::runtime_error("Corrupt rANS block");
+        const uint8_t* bitmap = p;
+        p += 32;
+        int count = 0;
+        for (int c = 0; c < 256; ++c)
+            ctxTable[c] = (bitmap[c >> 3] & (1 << (c & 7))) ? count++ : -1;
+        tables = arena.alloc<uint32_t>(size_t(count) * kScale);
+        for (int t = 0; t < count; ++t) {
+            if (!readFreqs(p, end, freq)) throw std::runtime_error("Corrupt rANS block");
+            buildDecodeTable(freq, &tables[size_t(t) * kScale]);
+        }
+    } else {
+        tables = arena.alloc<uint32_t>(kScale);
+        if (!readFreqs(p, end, freq)) throw std::runtime_error("Corrupt rANS block");
+        buildDecodeTable(freq, tables);
+    }
+
+    if (size_t(end - p) < 4 * kRansLanes) throw std::runtime_error("Corrupt rANS block");
+    uint32_t state[kRansLanes];
+    for (uint32_t& x : state) { x = getU32(p); p += 4; }
+    for (uint32_t x : state)
+        if (x < kRansL) throw std::runtime_error("Corrupt rANS block");
+
+    const size_t seg = segmentLength(rawSize);
+    uint8_t ctx[kRansLanes] = {0};
+    auto tableFor = [&](int k) -> const uint32_t* {
+        int t = ctxTable[ctx[k]];
+        return t < 0 ? nullptr : &tables[size_t(t) * kScale];
+    };
+
+    // Branch-free step: the renormalising read is always issued and only
+    // committed when the state dropped below L.
+    auto step = [&](uint32_t& x, const uint32_t* table) -> uint8_t {
+        uint32_t e = table[x & kMask];
+        x = ((e >> 20) + 1) * (x >> kScaleBits) + ((e >> 8) & kMask);
+        uint32_t w = getU16(p);
+        bool need = x < kRansL;
+        x = need ? (x << 16 | w) : x;
+        p += need ? 2 : 0;
+        return uint8_t(e);
+    };
+    // Tail step with a bounds-checked read
+    bool bad = false;
+    auto safeStep = [&](uint32_t& x, const uint32_t* table) -> uint8_t {
+        if (!table) { bad = true; return 0; }
+        uint32_t e = table[x & kMask];
+        x = ((e >> 20) + 1) * (x >> kScaleBits) + ((e >> 8) & kMask);
+        if (x < kRansL) {
+            if (end - p < 2) { bad = true; return 0; }
+            x = x << 16 | getU16(p);
+            p += 2;
+        }
+        return uint8_t(e);
+    };
+
+    size_t r = 0;
+    if (!order) {
+        const uint32_t* table = tables;
+        for (; r < seg && end - p >= 2 * kRansLanes; ++r)
+            for (int k = 0; k < kRansLanes; ++k) dst[size_t(k) * seg + r] = step(state[k], table);
+    } else {
+        for (; r < seg && end - p >= 2 * kRansLanes && !bad; ++r) {
+            for (int k = 0; k < kRansLanes; ++k) {
+                const uint32_t* table = tableFor(k);
+                if (!table) { bad = true; break; }
+                ctx[k] = dst[size_t(k) * seg + r] = step(state[k], table);
+            }
+        }
+    }
+    for (; r < seg && !bad; ++r)
+        for (int k = 0; k < kRansLanes; ++k)
+            ctx[k] = dst[size_t(k) * seg + r] = safeStep(state[k], order ? tableFor(k) : tables);
+    for (size_t pos = kRansLanes * seg; pos < rawSize && !bad; ++pos) {
+        const int k = kRansLanes - 1;
+        ctx[k] = dst[pos] = safeStep(state[k], order ? tableFor(k) : tables);
+    }
+
+    // The encoder started every state at L, so a clean stream ends there
+    for (uint32_t x : state) bad |= x != kRansL;
+    if (bad || p != end) throw std::runtime_error("Corrupt rANS block");
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ===== rANS entropy coder =====
+// Eight interleaved 32-bit rANS states with 16-bit renormalisation and
+// static 12-bit frequency tables stored in the block. The input is split
+// into eight contiguous segments, one per state, so order-1 contexts stay
+// local to a state and the decode loop has no cross-lane dependency.
+constexpr int kRansLanes = 8;
+
+// order 0: one table per block; order 1: one table per previous byte.
+void ransEncode(const uint8_t* src, size_t n, int order, std::vector<uint8_t>& out, Arena& arena);
+void ransDecode(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize, Arena& arena);
+
+// Order used for -a arith at the given level and block size.
+int ransOrderForLevel(int level, size_t blockSize);
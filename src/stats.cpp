@@ -0,0 +1,156 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const char* const kStageNames[size_t(Stage::Count)] = {
+    "read", "analyze", "encode", "decode", "checksum", "write"
+};
+static const size_t kStages = size_t(Stage::Count);
+static const size_t kMaxThreads = 256;  // later threads share the last slot
+
+struct TraceEvent {
+    Stage stage;
+    uint32_t thread;
+    uint64_t block;
+    uint64_t bytes;
+    int64_t start, end;
+};
+
+static struct {
+    Clock::time_point epoch;
+    std::clock_t cpuStart;
+    bool trace = false;
+    std::atomic<uint64_t> stageNs[kStages], stageCalls[kStages], stageBytes[kStages];
+    std::atomic<uint64_t> threadBlocks[kMaxThreads], threadBusyNs[kMaxThreads];
+    std::atomic<uint32_t> threads{0};
+    std::mutex eventsMutex;
+    std::vector<TraceEvent> events;
+} collector;
+
+// Small dense id for the calling thread, in order of first use.
+static uint32_t threadIndex() {
+    thread_local uint32_t index = collector.threads.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+void Stats::enable(bool trace) {
+    for (auto& c : counters) c.store(0);
+    for (size_t s = 0; s < kStages; ++s) {
+        collector.stageNs[s].store(0);
+        collector.stageCalls[s].store(0);
+        collector.stageBytes[s].store(0);
+    }
+    for (size_t t = 0; t < kMaxThreads; ++t) {
+        collector.threadBlocks[t].store(0);
+        collector.threadBusyNs[t].store(0);
+    }
+    collector.events.clear();
+    collector.trace = trace;
+    collector.epoch = Clock::now();
+    collector.cpuStart = std::clock();
+    on.store(true);
+}
+
+int64_t Stats::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - collector.epoch).count();
+}
+
+void Stats::record(Stage stage, uint64_t block, uint64_t bytes, int64_t start, int64_t end) {
+    const size_t s = size_t(stage);
+    const uint64_t ns = uint64_t(end - start);
+    collector.stageNs[s].fetch_add(ns, std::memory_order_relaxed);
+    collector.stageCalls[s].fetch_add(1, std::memory_order_relaxed);
+    collector.stageBytes[s].fetch_add(bytes, std::memory_order_relaxed);
+    const uint32_t thread = threadIndex();
+    if (stage == Stage::Encode || stage == Stage::Decode) {
+        const size_t t = std::min<size_t>(thread, kMaxThreads - 1);
+        collector.threadBlocks[t].fetch_add(1, std::memory_order_relaxed);
+        collector.threadBusyNs[t].fetch_add(ns, std::memory_order_relaxed);
+    }
+    if (collector.trace) {
+        std::lock_guard<std::mutex> lock(collector.eventsMutex);
+        collector.events.push_back({stage, thread, block, bytes, start, end});
+    }
+}
+
+void Stats::report(std::ostream& out) {
+    const double wall = double(now()) / 1e9;
+    const double cpu = double(std::clock() - collector.cpuStart) / CLOCKS_PER_SEC;
+    const auto counter = [](Counter c) { return counters[size_t(c)].load(); };
+    const std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3)
+        << "[stats] wall " << wall << " s, cpu " << cpu << " s\n"
+        << std::setprecision(1)
+        << "  stage       calls    total ms      MB/s\n";
+    for (size_t s = 0; s < kStages; ++s) {
+        const uint64_t calls = collector.stageCalls[s].load();
+        if (!calls) continue;
+        const double ms = double(collector.stageNs[s].load()) / 1e6;
+        const uint64_t bytes = collector.stageBytes[s].load();
+        out << "  " << std::left << std::setw(9) << kStageNames[s] << std::right << std::setw(8) << calls
+            << std::setw(12) << ms;
+        if (bytes && ms > 0) out << std::setw(10) << double(bytes) / (1 << 20) / (ms / 1e3);
+        out << '\n';
+    }
+    out << "  (encode and decode include analyze and checksum)\n";
+
+    const uint64_t in = counter(Counter::BytesIn), outBytes = counter(Counter::BytesOut);
+    if (counter(Counter::Blocks)) {
+        out << "  bytes in " << in << ", out " << outBytes;
+        if (in) out << " (" << 100.0 * double(outBytes) / double(in) << "%)";
+        out << ", " << counter(Counter::Blocks) << " block(s), " << counter(Counter::StoredBlocks) << " stored\n";
+    }
+    if (const uint64_t seqs = counter(Counter::Sequences)) {
+        out << "  lz77 " << seqs << " sequence(s), " << counter(Counter::MatchProbes) << " match probe(s), "
+            << double(counter(Counter::MatchProbes)) / double(seqs) << " per sequence\n";
+    }
+
+    const double io = double(collector.stageNs[size_t(Stage::Read)].load() +
+                             collector.stageNs[size_t(Stage::Write)].load()) / 1e6;
+    const double compute = double(collector.stageNs[size_t(Stage::Encode)].load() +
+                                  collector.stageNs[size_t(Stage::Decode)].load()) / 1e6;
+    out << "  io (read + write) " << io << " ms, compute (encode + decode) " << compute << " ms\n";
+    const size_t threads = std::min<size_t>(collector.threads.load(), kMaxThreads);
+    for (size_t t = 0; t < threads; ++t) {
+        const uint64_t blocks = collector.threadBlocks[t].load();
+        if (!blocks) continue;
+        out << "  thread " << t << ": " << blocks << " block(s), " << double(collector.threadBusyNs[t].load()) / 1e6
+            << " ms busy";
+        if (wall > 0) out << " (" << 100.0 * double(collector.threadBusyNs[t].load()) / 1e9 / wall << "%)";
+        out << '\n';
+    }
+    out.flags(flags);
+}
+
+void Stats::writeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Cannot open trace file " + path);
+    std::lock_guard<std::mutex> lock(collector.eventsMutex);
+    // Timestamps and durations are in microseconds
+    out << "{\"traceEvents\": [\n";
+    out << std::fixed << std::setprecision(3);
+    uint32_t threads = 0;
+    for (const TraceEvent& e : collector.events) {
+        out << "{\"name\": \"" << kStageNames[size_t(e.stage)] << "\", \"cat\": \"crush\", \"ph\": \"X\", \"pid\": 1"
+            << ", \"tid\": " << e.thread << ", \"ts\": " << double(e.start) / 1e3
+            << ", \"dur\": " << double(e.end - e.start) / 1e3
+            << ", \"args\": {\"block\": " << e.block << ", \"bytes\": " << e.bytes << "}},\n";
+        threads = std::max(threads, e.thread + 1);
+    }
+    for (uint32_t t = 0; t < threads; ++t) {
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+            << ", \"args\": {\"name\": \"crush-" << t << "\"}}" << (t + 1 < threads ? "," : "") << '\n';
+    }
+    out << "], \"displayTimeUnit\": \"ms\"}\n";
+    out.close();
+    if (!out) throw std::runtime_error("Failed writing trace file " + path);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// ===== Instrumentation =====
+// Stage timers and counters behind --stats, and Chrome trace events behind
+// --trace. Everything is recorded per block, never per byte, so a run with
+// stats on pays a couple of clock reads per block and a run with them off
+// a relaxed load per call site. Building with CRUSH_NO_STATS compiles the
+// call sites out altogether.
+enum class Stage : uint8_t { Read, Analyze, Encode, Decode, Checksum, Write, Count };
+enum class Counter : uint8_t { BytesIn, BytesOut, Blocks, StoredBlocks, Sequences, MatchProbes, Count };
+
+class Stats {
+public:
+    // Clears everything and starts collecting; `trace` also keeps one
+    // event per timed scope for writeTrace().
+    static void enable(bool trace);
+
+    static bool enabled() {
+#ifdef CRUSH_NO_STATS
+        return false;
+#else
+        return on.load(std::memory_order_relaxed);
+#endif
+    }
+
+    static void count(Counter c, uint64_t n) {
+        if (enabled()) counters[size_t(c)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Summary of the run so far.
+    static void report(std::ostream& out);
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto); needs enable(true).
+    static void writeTrace(const std::string& path);
+
+private:
+    friend class StageTimer;
+    static inline std::atomic<bool> on{false};
+    static inline std::atomic<uint64_t> counters[size_t(Counter::Count)];
+
+    static int64_t now();  // ns since enable()
+    static void record(Stage stage, uint64_t block, uint64_t bytes, int64_t start, int64_t end);
+};
+
+// Times the enclosing scope as one `stage` event, tagged with the block
+// it worked on and how many bytes it took in.
+class StageTimer {
+public:
+    StageTimer(Stage stage, uint64_t block, uint64_t bytes = 0)
+        : stage(stage), block(block), bytes(bytes), start(Stats::enabled() ? Stats::now() : -1) {}
+    ~StageTimer() {
+        if (start >= 0) Stats::record(stage, block, bytes, start, Stats::now());
+    }
+    // For work whose size is only known once it is done, e.g. a short read.
+    void setBytes(uint64_t n) { bytes = n; }
+    // Drops the event, e.g. for a read that only found end of input.
+    void discard() { start = -1; }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stage stage;
+    uint64_t block;
+    uint64_t bytes;
+    int64_t start;
+};
@@ -0,0 +1,52 @@
+#include "xxhash.hpp"
+
+static const uint32_t kPrime1 = 2654435761u;
+static const uint32_t kPrime2 = 2246822519u;
+static const uint32_t kPrime3 = 3266489917u;
+static const uint32_t kPrime4 = 668265263u;
+static const uint32_t kPrime5 = 374761393u;
+
+static inline uint32_t rotl(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+static inline uint32_t readLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+static inline uint32_t mixLane(uint32_t acc, uint32_t lane) {
+    return rotl(acc + lane * kPrime2, 13) * kPrime1;
+}
+
+uint32_t xxh32(const uint8_t* src, size_t n, uint32_t seed) {
+    const uint8_t* p = src;
+    const uint8_t* end = src + n;
+    uint32_t h;
+
+    if (n >= 16) {
+        uint32_t v1 = seed + kPrime1 + kPrime2;
+        uint32_t v2 = seed + kPrime2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - kPrime1;
+        const uint8_t* limit = end - 16;
+        do {
+            v1 = mixLane(v1, readLE32(p));
+            v2 = mixLane(v2, readLE32(p + 4));
+            v3 = mixLane(v3, readLE32(p + 8));
+            v4 = mixLane(v4, readLE32(p + 12));
+            p += 16;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    } else {
+        h = seed + kPrime5;
+    }
+
+    h += uint32_t(n);
+    for (; end - p >= 4; p += 4) h = rotl(h + readLE32(p) * kPrime3, 17) * kPrime4;
+    for (; p < end; ++p) h = rotl(h + *p * kPrime5, 11) * kPrime1;
+
+    h ^= h >> 15;
+    h *= kPrime2;
+    h ^= h >> 13;
+    h *= kPrime3;
+    h ^= h >> 16;
+    return h;
+}
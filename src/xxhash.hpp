@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ===== XXH32 =====
+// Block checksum. Four independent accumulators over 16-byte stripes keep
+// the loop at several GB/s, far below the cost of any of the coders.
+uint32_t xxh32(const uint8_t* src, size_t n, uint32_t seed = 0);